@@ -6,67 +6,8 @@
 #include "../../external/sol.hpp"
 #include "../io/filesystem.h"
 
-/*
-class Tile
-{
-public:
-    Tile(const std::string& name, int hardness, bool isTransparent)
-        : m_name(name), m_hardness(hardness), m_isTransparent(isTransparent) {}
-
-    std::string getName() const { return m_name; }
-    void setName(const std::string& newName) { m_name = newName; }
-
-    int getHardness() const { return m_hardness; }
-    void setHardness(int newHardness) { m_hardness = newHardness; }
-
-    bool getIsTransparent() const { return m_isTransparent; }
-    void setIsTransparent(bool transparency) { m_isTransparent = transparency; }
-
-private:
-    std::string m_name;
-    int m_hardness;
-    bool m_isTransparent;
-};
-*/
-
 Game::Game(const std::string& windowCaption, int tps, int startWidth, int startHeight) : m_timer(tps)
 {
-    /*
-    sol::state state;
-    state.open_libraries(sol::lib::base, sol::lib::package);
-
-    state.new_usertype<Tile>("Tile",
-        sol::constructors<Tile(const std::string&, int, bool)>(),
-        "get_name", &Tile::getName,
-        "set_name", &Tile::setName,
-        "get_hardness", &Tile::getHardness,
-        "set_hardness", &Tile::setHardness,
-        "get_transparent", &Tile::getIsTransparent,
-        "set_transparent", &Tile::setIsTransparent
-        // , "test_field", &Tile::testField
-    );
-
-    state.script(R"(
-function print_tile(tile)
-    print("Tile Name: " .. tile:get_name())
-    print("Tile Hardness: " .. tile:get_hardness())
-    print("Is Transparent: " .. tostring(tile:get_transparent()))
-    print()
-end
-
--- create cobblestone
-tile_cobblestone = Tile.new("Cobblestone", 3, false)
-print_tile(tile_cobblestone)
-print(tile_cobblestone.test_field)
-)");
-
-    Tile* cobblestone = state["tile_cobblestone"];
-    std::cout << "Accessing cobblestone made from lua from C++:" << std::endl;
-    std::cout << "Tile Name: " << cobblestone->getName() << std::endl;
-    std::cout << "Tile Hardness: " << cobblestone->getHardness() << std::endl;
-    std::cout << "Is Transparent: " << std::boolalpha << cobblestone->getIsTransparent() << std::endl;
-    */
-
     m_screenSize = { startWidth, startHeight };
 
     // SetConfigFlags(FLAG_WINDOW_RESIZABLE | FLAG_WINDOW_ALWAYS_RUN);
@@ -8,6 +8,7 @@
 #include <thread>
 #include <mutex>
 #include "../render/window.h"
+#include "../world/blockregistry.h"
 
 class State;
 
@@ -32,6 +33,8 @@ private:
 
     ScopedPtr<State> m_state;
     ScopedPtr<SoundManager> m_soundManager;
+
+    BlockRegistry m_blocks;
     
     Vec2<int> m_screenSize { 0 };
     
@@ -94,4 +97,7 @@ public:
     const Vec2<int> getWindowSize() const;
 
     Window* getWindow();
+
+    // States register their blocks while loading, before anything reads them
+    BlockRegistry& getBlocks() { return m_blocks; }
 };
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "bufferbuilder.h"
 #include <glad/glad.h>
 #include <iostream>
+#include <algorithm>
+#include <limits>
 
 void BufferBuilder::bindBuffer(unsigned int target, unsigned int buffer)
 {
@@ -19,11 +21,44 @@ BufferBuilder::BufferBuilder()
 	glGenBuffers(1, &m_ibo);
 }
 
+BufferBuilder& BufferBuilder::setVertexData(const void* data, size_t count, size_t stride)
+{
+	m_stride = stride;
+	bindBuffer(GL_ARRAY_BUFFER, m_vbo);
+	bufferData(GL_ARRAY_BUFFER, count * stride, data, GL_STATIC_DRAW);
+	return *this;
+}
+
 BufferBuilder& BufferBuilder::setIndices(const std::vector<unsigned int>& indices)
 {
+	unsigned int maxIndex = indices.empty() ? 0 : *std::max_element(indices.begin(), indices.end());
+
+	// Nearly every mesh fits in 16 bit indices, which halves the index buffer
+	if (maxIndex <= std::numeric_limits<unsigned short>::max())
+	{
+		return setIndices(std::vector<unsigned short>(indices.begin(), indices.end()));
+	}
+
+	return setIndices(indices.data(), indices.size(), GL_UNSIGNED_INT, maxIndex);
+}
+
+BufferBuilder& BufferBuilder::setIndices(const std::vector<unsigned short>& indices)
+{
+	unsigned int maxIndex = indices.empty() ? 0 : *std::max_element(indices.begin(), indices.end());
+	return setIndices(indices.data(), indices.size(), GL_UNSIGNED_SHORT, maxIndex);
+}
+
+BufferBuilder& BufferBuilder::setIndices(const void* data, size_t count, unsigned int type, unsigned int maxIndex)
+{
+	m_indexCount = count;
+	m_maxIndex = maxIndex;
+	m_indexType = type;
+
+	size_t size = (type == GL_UNSIGNED_SHORT) ? sizeof(unsigned short) : sizeof(unsigned int);
+
 	glBindVertexArray(m_vao);
 	bindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo);
-	bufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+	bufferData(GL_ELEMENT_ARRAY_BUFFER, count * size, data, GL_STATIC_DRAW);
 	return *this;
 }
 
@@ -36,6 +71,15 @@ BufferBuilder& BufferBuilder::addAttribute(unsigned int location, int size, unsi
 	return *this;
 }
 
+BufferBuilder& BufferBuilder::addIntegerAttribute(unsigned int location, int size, unsigned int type, size_t offset)
+{
+	glBindVertexArray(m_vao);
+	bindBuffer(GL_ARRAY_BUFFER, m_vbo);
+	glVertexAttribIPointer(location, size, type, m_stride, (void*)offset);
+	glEnableVertexAttribArray(location);
+	return *this;
+}
+
 void BufferBuilder::build()
 {
 	bindBuffer(GL_ARRAY_BUFFER, 0);
@@ -6,7 +6,11 @@ class BufferBuilder
 {
 private:
 	size_t m_stride = 0;
-	
+
+	size_t m_indexCount = 0;
+	unsigned int m_maxIndex = 0;
+	unsigned int m_indexType = 0x1405; // GL_UNSIGNED_INT
+
 	unsigned int m_vao = 0;
 	unsigned int m_vbo = 0;
 	unsigned int m_ibo = 0;
@@ -32,6 +36,23 @@ public:
 		return m_ibo;
 	}
 
+	// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, whichever setIndices picked
+	unsigned int getIndexType() const
+	{
+		return m_indexType;
+	}
+
+	size_t getIndexCount() const
+	{
+		return m_indexCount;
+	}
+
+	// Highest referenced vertex, for glDrawRangeElements
+	unsigned int getMaxIndex() const
+	{
+		return m_maxIndex;
+	}
+
 	BufferBuilder();
 
 	template<typename T>
@@ -43,15 +64,24 @@ public:
 	template<typename T>
 	BufferBuilder& setVertexData(const std::vector<T>& data)
 	{
-		m_stride = sizeof(T);
-		bindBuffer(0x8892, m_vbo);
-		bufferData(0x8892 /*GL_ARRAY_BUFFER*/, data.size() * sizeof(T), data.data(), /*GL_STATIC_DRAW*/ 0x88E4);
-		return *this;
+		return setVertexData(data.data(), data.size(), sizeof(T));
 	}
 
+	// Raw form for vertex blobs that aren't held in a vector, like a mapped file
+	BufferBuilder& setVertexData(const void* data, size_t count, size_t stride);
+
+	// Indices are narrowed to 16 bits whenever every index fits
 	BufferBuilder& setIndices(const std::vector<unsigned int>& indices);
 
+	BufferBuilder& setIndices(const std::vector<unsigned short>& indices);
+
+	// Uploads already narrowed indices as is, type is GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	BufferBuilder& setIndices(const void* data, size_t count, unsigned int type, unsigned int maxIndex);
+
 	BufferBuilder& addAttribute(unsigned int location, int size, unsigned int type, bool normalized, size_t offset);
 
+	// Integer attribute read as int/uint in the shader instead of being converted to float, for packed vertices
+	BufferBuilder& addIntegerAttribute(unsigned int location, int size, unsigned int type, size_t offset);
+
 	void build();
 };
\ No newline at end of file
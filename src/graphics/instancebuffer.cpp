@@ -0,0 +1,74 @@
+#include "instancebuffer.h"
+#include <glad/glad.h>
+
+InstanceBuffer::InstanceBuffer()
+{
+	glGenBuffers(1, &m_vbo);
+}
+
+InstanceBuffer::~InstanceBuffer()
+{
+	glDeleteBuffers(1, &m_vbo);
+}
+
+void InstanceBuffer::clear()
+{
+	m_instances.clear();
+}
+
+void InstanceBuffer::add(const glm::mat4& transform, const glm::vec4& tint)
+{
+	m_instances.push_back({ transform, tint });
+}
+
+void InstanceBuffer::upload()
+{
+	glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+
+	size_t bytes = m_instances.size() * sizeof(Instance);
+	if (bytes > m_capacity)
+	{
+		m_capacity = bytes;
+		glBufferData(GL_ARRAY_BUFFER, m_capacity, m_instances.data(), GL_STREAM_DRAW);
+	}
+	else
+	{
+		// Orphan the old storage so the driver doesn't stall on last frame's draws
+		glBufferData(GL_ARRAY_BUFFER, m_capacity, nullptr, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, m_instances.data());
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBuffer::attach() const
+{
+	glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+
+	// A mat4 attribute takes up four consecutive vec4 locations
+	for (unsigned int i = 0; i < 4; ++i)
+	{
+		unsigned int location = TRANSFORM_LOCATION + i;
+		glVertexAttribPointer(location, 4, GL_FLOAT, false, sizeof(Instance), (void*)(offsetof(Instance, transform) + sizeof(glm::vec4) * i));
+		glEnableVertexAttribArray(location);
+		glVertexAttribDivisor(location, 1);
+	}
+
+	glVertexAttribPointer(TINT_LOCATION, 4, GL_FLOAT, false, sizeof(Instance), (void*)offsetof(Instance, tint));
+	glEnableVertexAttribArray(TINT_LOCATION);
+	glVertexAttribDivisor(TINT_LOCATION, 1);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBuffer::detach()
+{
+	for (unsigned int i = 0; i < 4; ++i)
+	{
+		glDisableVertexAttribArray(TRANSFORM_LOCATION + i);
+		glVertexAttribDivisor(TRANSFORM_LOCATION + i, 0);
+	}
+
+	glDisableVertexAttribArray(TINT_LOCATION);
+	glVertexAttribDivisor(TINT_LOCATION, 0);
+}
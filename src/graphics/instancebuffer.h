@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+#include <mat4x4.hpp>
+#include <vec4.hpp>
+
+// Per-instance data for glDrawElementsInstanced. The vertex shader reads it as
+//	layout(location = 3) in mat4 instanceTransform;
+//	layout(location = 7) in vec4 instanceTint;
+class InstanceBuffer
+{
+public:
+	struct Instance
+	{
+		glm::mat4 transform;
+		glm::vec4 tint;
+	};
+
+	static constexpr unsigned int TRANSFORM_LOCATION = 3;
+	static constexpr unsigned int TINT_LOCATION = 7;
+
+private:
+	unsigned int m_vbo = 0;
+
+	std::vector<Instance> m_instances;
+
+	// Size of the GL buffer, so uploads only reallocate when they outgrow it
+	size_t m_capacity = 0;
+
+public:
+	InstanceBuffer();
+
+	~InstanceBuffer();
+
+	InstanceBuffer(const InstanceBuffer& other) = delete;
+
+	InstanceBuffer& operator=(const InstanceBuffer& other) = delete;
+
+	unsigned int getVBO() const
+	{
+		return m_vbo;
+	}
+
+	size_t size() const
+	{
+		return m_instances.size();
+	}
+
+	bool empty() const
+	{
+		return m_instances.empty();
+	}
+
+	void clear();
+
+	void add(const glm::mat4& transform, const glm::vec4& tint = glm::vec4(1.0f));
+
+	// Send the collected instances to the GPU, call once per frame after adding
+	void upload();
+
+	// Point the instance attributes of the currently bound VAO at this buffer
+	void attach() const;
+
+	// Disables the instance attributes of the currently bound VAO again
+	static void detach();
+};
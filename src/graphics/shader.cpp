@@ -43,6 +43,15 @@ void Shader::setVec2(const std::string& uniform, float a, float b)
     glUniform2f(getLocation(uniform), a, b);
 }
 
+void Shader::setUniformBlock(const std::string& block, unsigned int binding)
+{
+    GLuint index = glGetUniformBlockIndex(m_programId, block.c_str());
+    if (index != GL_INVALID_INDEX)
+    {
+        glUniformBlockBinding(m_programId, index, binding);
+    }
+}
+
 void Shader::bind() const
 {
     glUseProgram(m_programId);
@@ -30,6 +30,9 @@ public:
 
     void setVec2(const std::string& uniform, float a, float b);
 
+    // Connects a uniform block to the buffer bound at the given binding point
+    void setUniformBlock(const std::string& block, unsigned int binding);
+
     void bind() const;
 
     void unbind() const;
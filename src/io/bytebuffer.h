@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+// Appends plain values to a byte vector in native (little endian) order
+class ByteWriter
+{
+private:
+    std::vector<uint8_t>& m_out;
+
+public:
+    ByteWriter(std::vector<uint8_t>& out) : m_out(out) {}
+
+    template<typename T>
+    void write(const T& value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "ByteWriter only writes plain values");
+        writeBytes(&value, sizeof(T));
+    }
+
+    void writeBytes(const void* data, size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        m_out.insert(m_out.end(), bytes, bytes + size);
+    }
+};
+
+// Reads values written by ByteWriter. Reading past the end zero fills and sets the failed flag
+// instead of touching memory it doesn't own, so callers only need to check once at the end
+class ByteReader
+{
+private:
+    const uint8_t* m_data;
+    const uint8_t* m_end;
+    bool m_failed = false;
+
+public:
+    ByteReader(const uint8_t* data, size_t size) : m_data(data), m_end(data + size) {}
+
+    template<typename T>
+    T read()
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "ByteReader only reads plain values");
+        T value;
+        readBytes(&value, sizeof(T));
+        return value;
+    }
+
+    void readBytes(void* data, size_t size)
+    {
+        if (m_failed || static_cast<size_t>(m_end - m_data) < size)
+        {
+            m_failed = true;
+            std::memset(data, 0, size);
+            return;
+        }
+
+        std::memcpy(data, m_data, size);
+        m_data += size;
+    }
+
+    void fail() { m_failed = true; }
+
+    bool hasFailed() const { return m_failed; }
+
+    size_t getRemaining() const { return m_end - m_data; }
+};
@@ -0,0 +1,125 @@
+#include "mappedfile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path)
+{
+    open(path);
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path)
+{
+    close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    m_file = file;
+    m_mapping = mapping;
+    m_data = static_cast<const unsigned char*>(view);
+    m_size = static_cast<size_t>(size.QuadPart);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (m_data != nullptr)
+    {
+        UnmapViewOfFile(m_data);
+        CloseHandle(m_mapping);
+        CloseHandle(m_file);
+    }
+
+    m_data = nullptr;
+    m_size = 0;
+    m_file = nullptr;
+    m_mapping = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path)
+{
+    close();
+
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(file, &info) != 0 || info.st_size == 0)
+    {
+        ::close(file);
+        return false;
+    }
+
+    void* view = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    if (view == MAP_FAILED)
+    {
+        ::close(file);
+        return false;
+    }
+
+    m_file = file;
+    m_data = static_cast<const unsigned char*>(view);
+    m_size = static_cast<size_t>(info.st_size);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (m_data != nullptr)
+    {
+        munmap(const_cast<unsigned char*>(m_data), m_size);
+        ::close(m_file);
+    }
+
+    m_data = nullptr;
+    m_size = 0;
+    m_file = -1;
+}
+
+#endif
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+// Read only memory mapping of a whole file, unmapped when destroyed
+class MappedFile
+{
+private:
+    const unsigned char* m_data = nullptr;
+    size_t m_size = 0;
+
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#else
+    int m_file = -1;
+#endif
+
+public:
+    MappedFile() = default;
+
+    MappedFile(const std::string& path);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile& other) = delete;
+
+    MappedFile& operator=(const MappedFile& other) = delete;
+
+    bool open(const std::string& path);
+
+    void close();
+
+    bool isOpen() const { return m_data != nullptr; }
+
+    const unsigned char* getData() const { return m_data; }
+
+    size_t getSize() const { return m_size; }
+};
@@ -5,6 +5,7 @@
 #include <glad/glad.h>
 #include "../utility/defines.h"
 #include "../graphics/bufferbuilder.h"
+#include "../graphics/instancebuffer.h"
 #include <array>
 
 void CubeMesh::flipFaces()
@@ -34,9 +35,9 @@ static void checkGLErr(const std::string& location)
 	}
 }
 
-void CubeMesh::upload(float scale)
+void CubeMesh::bake(float scale)
 {
-	if (m_vertices.empty() || m_vertices.size() % 4 != 0)
+	if (m_baked || m_vertices.empty() || m_vertices.size() % 4 != 0)
 	{
 		return;
 	}
@@ -57,6 +58,20 @@ void CubeMesh::upload(float scale)
 	calculateNormals();
 	calculateIndices();
 
+	m_optimizeStats = optimize();
+
+	m_baked = true;
+}
+
+void CubeMesh::upload(float scale)
+{
+	bake(scale);
+
+	if (!m_baked)
+	{
+		return;
+	}
+
 	BufferBuilder builder;
 
 	builder.setVertexData<Vertex>(m_vertices)
@@ -69,12 +84,16 @@ void CubeMesh::upload(float scale)
 	m_VBO = builder.getVBO();
 	m_EBO = builder.getIBO();
 
+	m_indexType = builder.getIndexType();
+	m_maxIndex = builder.getMaxIndex();
+
 	m_compiled = true;
 }
 
 void CubeMesh::init(Vec2<int> texSize, Vec2<int> texOffset, bool mirrored)
 {
 	m_vertices.clear();
+	m_baked = false;
 
 	m_texSize = texSize;
 	m_texOffset = texOffset;
@@ -208,6 +227,29 @@ void CubeMesh::addBox(Vec3<float> min, Vec3<int> size, float extrusion)
 	}
 }
 
+void CubeMesh::applyTransform(MatrixStack* matrix, float scale) const
+{
+	applyTransform(matrix, rotationPoint, rotationAngle, scale);
+}
+
+void CubeMesh::applyTransform(MatrixStack* matrix, const Vec3<float>& point, const Vec3<float>& angle, float scale)
+{
+	matrix->translate(point.x * scale, point.y * scale, point.z * scale);
+
+	if (angle.z != 0.f)
+	{
+		matrix->rotate(RAD2DEG(angle.x), 0.0f, 0.0f, 1.0f);
+	}
+	if (angle.y != 0.f)
+	{
+		matrix->rotate(RAD2DEG(angle.y), 0.0f, 1.0f, 0.0f);
+	}
+	if (angle.x != 0.f)
+	{
+		matrix->rotate(RAD2DEG(angle.z), 1.0f, 0.0f, 0.0f);
+	}
+}
+
 void CubeMesh::render(MatrixStack* matrix, Shader* shader, Texture* texture, float scale)
 {
 	if (!m_compiled)
@@ -217,34 +259,69 @@ void CubeMesh::render(MatrixStack* matrix, Shader* shader, Texture* texture, flo
 
 	matrix->push();
 
-	matrix->translate(rotationPoint.x * scale, rotationPoint.y * scale, rotationPoint.z * scale);
+	applyTransform(matrix, scale);
+
+	shader->setMat4("model", false, matrix->top());
+
+	// bind
+	glBindVertexArray(m_VAO);
+	if (texture != nullptr)
+	{
+		texture->bind(0);
+	}
+
+	// draw
+	glDrawRangeElements(GL_TRIANGLES, 0, m_maxIndex, m_indices.size(), m_indexType, 0);
 
-	if (rotationAngle.z != 0.f)
+	// unbind
+	glBindVertexArray(0);
+	if (texture != nullptr)
 	{
-		matrix->rotate(RAD2DEG(rotationAngle.x), 0.0f, 0.0f, 1.0f);
+		texture->unbind();
 	}
-	if (rotationAngle.y != 0.f)
+
+	matrix->pop();
+}
+
+void CubeMesh::render(MatrixStack* matrix, Shader* shader, float scale)
+{
+	render(matrix, shader, nullptr, scale);
+}
+
+void CubeMesh::renderInstanced(MatrixStack* matrix, Shader* shader, Texture* texture, const InstanceBuffer& instances, float scale)
+{
+	if (!m_compiled)
 	{
-		matrix->rotate(RAD2DEG(rotationAngle.y), 0.0f, 1.0f, 0.0f);
+		upload(scale);
 	}
-	if (rotationAngle.x != 0.f)
+
+	if (instances.empty())
 	{
-		matrix->rotate(RAD2DEG(rotationAngle.z), 1.0f, 0.0f, 0.0f);
+		return;
 	}
 
+	// The part pose is shared by every instance, so it only goes through the stack once
+	matrix->push();
+
+	applyTransform(matrix, scale);
+
 	shader->setMat4("model", false, matrix->top());
 
 	// bind
+	// Attached for this draw only. A buffer name can be reused once its InstanceBuffer is gone,
+	// and plain render() calls mustn't find per-instance arrays left enabled on the VAO
 	glBindVertexArray(m_VAO);
+	instances.attach();
 	if (texture != nullptr)
 	{
 		texture->bind(0);
 	}
 
 	// draw
-	glDrawElements(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, 0);
+	glDrawElementsInstanced(GL_TRIANGLES, m_indices.size(), m_indexType, 0, instances.size());
 
 	// unbind
+	InstanceBuffer::detach();
 	glBindVertexArray(0);
 	if (texture != nullptr)
 	{
@@ -252,9 +329,4 @@ void CubeMesh::render(MatrixStack* matrix, Shader* shader, Texture* texture, flo
 	}
 
 	matrix->pop();
-}
-
-void CubeMesh::render(MatrixStack* matrix, Shader* shader, float scale)
-{
-	render(matrix, shader, nullptr, scale);
 }
\ No newline at end of file
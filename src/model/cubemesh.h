@@ -5,18 +5,31 @@
 
 class MatrixStack;
 class Shader;
+class InstanceBuffer;
 
 class CubeMesh : public Mesh
 {
+	friend class CubeModel;
+
 private:
 	Vec2<int> m_texSize { 0 };
 	Vec2<int> m_texOffset { 0 };
 
 	bool m_compiled = false;
+	bool m_baked = false;
 	bool m_mirrored = false;
 
+	MeshOptimizer::Stats m_optimizeStats;
+
 	void flipFaces();
 
+	void applyTransform(MatrixStack* matrix, float scale) const;
+
+	static void applyTransform(MatrixStack* matrix, const Vec3<float>& point, const Vec3<float>& angle, float scale);
+
+	// Scales the vertices and generates normals & indices, without touching GL
+	void bake(float scale);
+
 public:
 	CubeMesh() = default;
 
@@ -34,6 +47,15 @@ public:
 	void render(MatrixStack* matrix, Shader* shader, Texture* texture, float scale);
 	void render(MatrixStack* matrix, Shader* shader, float scale);
 
+	// Vertex count and ACMR before & after the bake time optimisation
+	const MeshOptimizer::Stats& getOptimizeStats() const
+	{
+		return m_optimizeStats;
+	}
+
+	// Draws this part once for every instance, the shader applies instanceTransform after "model"
+	void renderInstanced(MatrixStack* matrix, Shader* shader, Texture* texture, const InstanceBuffer& instances, float scale);
+
 	CubeMesh(const CubeMesh& other) = delete;
 
 	CubeMesh& operator=(const CubeMesh& other) = delete;
@@ -0,0 +1,381 @@
+#include "cubemodel.h"
+#include "cubemesh.h"
+#include "../utility/matrixstack.h"
+#include "../graphics/shader.h"
+#include "../graphics/texture.h"
+#include "../graphics/bufferbuilder.h"
+#include "../io/mappedfile.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+// Baked model file layout, every block starts 4 byte aligned:
+//	ModelFileHeader
+//	ModelFilePart[partCount]
+//	CubeModel::Vertex[vertexCount]
+//	uint16_t or uint32_t[indexCount], padded to 4 bytes
+constexpr uint32_t MODEL_FILE_MAGIC = 0x4C444D43; // "CMDL"
+constexpr uint32_t MODEL_FILE_VERSION = 1;
+
+struct ModelFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	int32_t texWidth, texHeight;
+	float scale;
+	uint32_t partCount;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t indexSize;
+	uint32_t maxIndex;
+};
+
+struct ModelFilePart
+{
+	int32_t parent;
+	float rotationPoint[3];
+	float rotationAngle[3];
+};
+
+CubeModel::~CubeModel()
+{
+	if (m_paletteUBO != 0)
+	{
+		glDeleteBuffers(1, &m_paletteUBO);
+	}
+}
+
+int CubeModel::addPart(CubeMesh* part, int parent)
+{
+	if (m_parts.size() >= MAX_PARTS)
+	{
+		std::cout << "[WARNING] CubeModel can't hold more than " << MAX_PARTS << " parts!\n";
+		return -1;
+	}
+
+	if (parent >= static_cast<int>(m_parts.size()))
+	{
+		std::cout << "[WARNING] CubeModel part parent has to be added before its children!\n";
+		parent = -1;
+	}
+
+	// A model read by load() has no meshes left to rebake the other parts from
+	if (m_loaded && std::any_of(m_parts.begin(), m_parts.end(), [](const Part& existing) { return existing.mesh == nullptr; }))
+	{
+		std::cout << "[WARNING] Parts can't be added to a CubeModel loaded from a file!\n";
+		return -1;
+	}
+
+	// The baked buffers don't have the new part yet, the next render builds them again
+	unload();
+
+	m_parts.push_back({ part, parent, part->rotationPoint, part->rotationAngle });
+	return static_cast<int>(m_parts.size()) - 1;
+}
+
+void CubeModel::setRotationAngle(int part, const Vec3<float>& angle)
+{
+	m_parts[part].rotationAngle = angle;
+}
+
+void CubeModel::gather(float scale, std::vector<Vertex>& vertices)
+{
+	vertices.clear();
+	m_indices.clear();
+
+	for (size_t i = 0; i < m_parts.size(); ++i)
+	{
+		// Parts read back by load() have no mesh, only their pose
+		CubeMesh* mesh = m_parts[i].mesh;
+		if (mesh == nullptr)
+		{
+			continue;
+		}
+
+		mesh->bake(scale);
+
+		if (m_texSize.x == 0)
+		{
+			m_texSize = mesh->m_texSize;
+		}
+
+		unsigned int base = static_cast<unsigned int>(vertices.size());
+
+		for (const auto& v : mesh->m_vertices)
+		{
+			vertices.push_back({ v.x, v.y, v.z, v.u, v.v, static_cast<float>(i) });
+		}
+
+		for (unsigned int index : mesh->m_indices)
+		{
+			m_indices.push_back(base + index);
+		}
+	}
+
+	m_scale = scale;
+}
+
+void CubeModel::build(float scale)
+{
+	std::vector<Vertex> vertices;
+	gather(scale, vertices);
+
+	if (vertices.empty())
+	{
+		return;
+	}
+
+	upload(vertices.data(), vertices.size(), nullptr, 0, 0, 0);
+}
+
+void CubeModel::upload(const void* vertices, size_t vertexCount, const void* indices, size_t indexCount, unsigned int indexType, unsigned int maxIndex)
+{
+	// Building or loading again replaces the old buffers
+	unload();
+
+	BufferBuilder builder;
+
+	builder.setVertexData(vertices, vertexCount, sizeof(Vertex));
+
+	// Without a prepared blob the gathered indices pick their own width
+	if (indices != nullptr)
+	{
+		builder.setIndices(indices, indexCount, indexType, maxIndex);
+	}
+	else
+	{
+		builder.setIndices(m_indices);
+	}
+
+	builder.addAttribute(0, 3, GL_FLOAT, false, offsetof(Vertex, x))		// Position
+		.addAttribute(1, 2, GL_FLOAT, false, offsetof(Vertex, u))		// UV coords
+		.addAttribute(2, 1, GL_FLOAT, false, offsetof(Vertex, part))	// Part index
+		.build();
+
+	m_VAO = builder.getVAO();
+	m_VBO = builder.getVBO();
+	m_EBO = builder.getIBO();
+
+	m_indexType = builder.getIndexType();
+	m_maxIndex = builder.getMaxIndex();
+	m_indexCount = builder.getIndexCount();
+
+	// Sized for MAX_PARTS, so one is enough whatever gets uploaded later
+	if (m_paletteUBO == 0)
+	{
+		glGenBuffers(1, &m_paletteUBO);
+		glBindBuffer(GL_UNIFORM_BUFFER, m_paletteUBO);
+		glBufferData(GL_UNIFORM_BUFFER, MAX_PARTS * sizeof(glm::mat4), nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	m_loaded = true;
+}
+
+bool CubeModel::save(const std::string& path, float scale)
+{
+	for (const Part& part : m_parts)
+	{
+		if (part.mesh == nullptr)
+		{
+			std::cout << "[ERROR] Can't save model file " << path << ", the model was loaded from a file and has no meshes to bake\n";
+			return false;
+		}
+	}
+
+	std::vector<Vertex> vertices;
+	gather(scale, vertices);
+
+	if (vertices.empty())
+	{
+		return false;
+	}
+
+	// Same width BufferBuilder would pick, so loading never has to narrow
+	unsigned int maxIndex = *std::max_element(m_indices.begin(), m_indices.end());
+	bool narrow = maxIndex <= std::numeric_limits<uint16_t>::max();
+
+	ModelFileHeader header = {};
+	header.magic = MODEL_FILE_MAGIC;
+	header.version = MODEL_FILE_VERSION;
+	header.texWidth = m_texSize.x;
+	header.texHeight = m_texSize.y;
+	header.scale = scale;
+	header.partCount = static_cast<uint32_t>(m_parts.size());
+	header.vertexCount = static_cast<uint32_t>(vertices.size());
+	header.indexCount = static_cast<uint32_t>(m_indices.size());
+	header.indexSize = narrow ? sizeof(uint16_t) : sizeof(uint32_t);
+	header.maxIndex = maxIndex;
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "[ERROR] Could not write model file " << path << "\n";
+		return false;
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	syncPoses();
+
+	for (const Part& part : m_parts)
+	{
+		ModelFilePart record =
+		{
+			part.parent,
+			{ part.rotationPoint.x, part.rotationPoint.y, part.rotationPoint.z },
+			{ part.rotationAngle.x, part.rotationAngle.y, part.rotationAngle.z }
+		};
+		file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+	}
+
+	file.write(reinterpret_cast<const char*>(vertices.data()), vertices.size() * sizeof(Vertex));
+
+	if (narrow)
+	{
+		std::vector<uint16_t> indices(m_indices.begin(), m_indices.end());
+		if (indices.size() % 2 != 0)
+		{
+			indices.push_back(0);
+		}
+		file.write(reinterpret_cast<const char*>(indices.data()), indices.size() * sizeof(uint16_t));
+	}
+	else
+	{
+		file.write(reinterpret_cast<const char*>(m_indices.data()), m_indices.size() * sizeof(uint32_t));
+	}
+
+	return file.good();
+}
+
+bool CubeModel::load(const std::string& path)
+{
+	MappedFile file(path);
+	if (!file.isOpen() || file.getSize() < sizeof(ModelFileHeader))
+	{
+		std::cout << "[ERROR] Could not open model file " << path << "\n";
+		return false;
+	}
+
+	ModelFileHeader header;
+	std::memcpy(&header, file.getData(), sizeof(header));
+
+	if (header.magic != MODEL_FILE_MAGIC || header.version != MODEL_FILE_VERSION ||
+		header.partCount > MAX_PARTS || (header.indexSize != 2 && header.indexSize != 4))
+	{
+		std::cout << "[ERROR] " << path << " is not a supported model file\n";
+		return false;
+	}
+
+	size_t partsOffset = sizeof(ModelFileHeader);
+	size_t verticesOffset = partsOffset + header.partCount * sizeof(ModelFilePart);
+	size_t indicesOffset = verticesOffset + static_cast<size_t>(header.vertexCount) * sizeof(Vertex);
+	size_t end = indicesOffset + static_cast<size_t>(header.indexCount) * header.indexSize;
+
+	if (end > file.getSize() || header.vertexCount == 0 || header.maxIndex >= header.vertexCount)
+	{
+		std::cout << "[ERROR] Model file " << path << " is truncated\n";
+		return false;
+	}
+
+	m_parts.clear();
+	for (uint32_t i = 0; i < header.partCount; ++i)
+	{
+		ModelFilePart record;
+		std::memcpy(&record, file.getData() + partsOffset + i * sizeof(ModelFilePart), sizeof(record));
+
+		m_parts.push_back({
+			nullptr,
+			record.parent < static_cast<int32_t>(i) ? record.parent : -1,
+			{ record.rotationPoint[0], record.rotationPoint[1], record.rotationPoint[2] },
+			{ record.rotationAngle[0], record.rotationAngle[1], record.rotationAngle[2] }
+		});
+	}
+
+	m_texSize = { header.texWidth, header.texHeight };
+	m_scale = header.scale;
+	m_indices.clear();
+
+	upload(
+		file.getData() + verticesOffset, header.vertexCount,
+		file.getData() + indicesOffset, header.indexCount,
+		header.indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, header.maxIndex
+	);
+
+	return true;
+}
+
+void CubeModel::syncPoses()
+{
+	for (Part& part : m_parts)
+	{
+		if (part.mesh != nullptr)
+		{
+			part.rotationPoint = part.mesh->rotationPoint;
+			part.rotationAngle = part.mesh->rotationAngle;
+		}
+	}
+}
+
+void CubeModel::evaluatePalette()
+{
+	syncPoses();
+
+	m_palette.resize(m_parts.size());
+
+	MatrixStack pose;
+
+	for (size_t i = 0; i < m_parts.size(); ++i)
+	{
+		const Part& part = m_parts[i];
+
+		// Parents are always earlier in the list, so their pose is ready
+		pose.insert(part.parent < 0 ? glm::mat4(1.0f) : m_palette[part.parent]);
+		CubeMesh::applyTransform(&pose, part.rotationPoint, part.rotationAngle, m_scale);
+		m_palette[i] = pose.top();
+	}
+}
+
+void CubeModel::render(MatrixStack* matrix, Shader* shader, Texture* texture, float scale)
+{
+	if (!m_loaded)
+	{
+		build(scale);
+
+		if (!m_loaded)
+		{
+			return;
+		}
+	}
+
+	evaluatePalette();
+
+	glBindBuffer(GL_UNIFORM_BUFFER, m_paletteUBO);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, m_palette.size() * sizeof(glm::mat4), m_palette.data());
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, PALETTE_BINDING, m_paletteUBO);
+
+	shader->setUniformBlock("ModelPalette", PALETTE_BINDING);
+	shader->setMat4("model", false, matrix->top());
+
+	// bind
+	glBindVertexArray(m_VAO);
+	if (texture != nullptr)
+	{
+		texture->bind(0);
+	}
+
+	// draw
+	glDrawRangeElements(GL_TRIANGLES, 0, m_maxIndex, m_indexCount, m_indexType, 0);
+
+	// unbind
+	glBindVertexArray(0);
+	if (texture != nullptr)
+	{
+		texture->unbind();
+	}
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <mat4x4.hpp>
+#include "mesh.h"
+#include "../utility/vec.h"
+
+class CubeMesh;
+class MatrixStack;
+class Shader;
+
+// Bakes a set of CubeMesh parts into one vertex & index buffer so a whole posed
+// model is a single draw. Each vertex carries its part index, and the part poses
+// are uploaded as a matrix palette the vertex shader reads as
+//	layout(location = 2) in float part;
+//	layout(std140) uniform ModelPalette { mat4 parts[32]; };
+// with gl_Position = projection * view * model * parts[int(part)] * vec4(position, 1.0)
+class CubeModel : public MeshBase
+{
+public:
+	static constexpr int MAX_PARTS = 32;
+	static constexpr unsigned int PALETTE_BINDING = 0;
+
+private:
+	struct Vertex
+	{
+		float x, y, z;
+		float u, v;
+		float part;
+	};
+
+	struct Part
+	{
+		CubeMesh* mesh;
+		int parent;
+		Vec3<float> rotationPoint;
+		Vec3<float> rotationAngle;
+	};
+
+	std::vector<Part> m_parts;
+	std::vector<glm::mat4> m_palette;
+
+	unsigned int m_paletteUBO = 0;
+
+	size_t m_indexCount = 0;
+
+	// Scale the vertices were baked at, pivots are scaled to match
+	float m_scale = 1.0f;
+
+	Vec2<int> m_texSize { 0 };
+
+	void gather(float scale, std::vector<Vertex>& vertices);
+
+	void build(float scale);
+
+	void upload(const void* vertices, size_t vertexCount, const void* indices, size_t indexCount, unsigned int indexType, unsigned int maxIndex);
+
+	// Copies the current pose of parts that are backed by a CubeMesh
+	void syncPoses();
+
+	void evaluatePalette();
+
+public:
+	CubeModel() = default;
+
+	virtual ~CubeModel() override;
+
+	// Parts keep posing through their rotationPoint / rotationAngle, a parent has
+	// to be added before its children and returns the index to parent them with.
+	// Adding to a model that was already drawn rebuilds it on the next render
+	int addPart(CubeMesh* part, int parent = -1);
+
+	size_t getPartCount() const
+	{
+		return m_parts.size();
+	}
+
+	Vec2<int> getTexSize() const
+	{
+		return m_texSize;
+	}
+
+	// Poses a part of a model loaded from a baked file, which has no CubeMesh to pose
+	void setRotationAngle(int part, const Vec3<float>& angle);
+
+	// Writes the baked geometry, hierarchy & pivots so load can skip all per vertex work.
+	// Bakes from the CubeMesh parts, so a model that came from load can't be saved again
+	bool save(const std::string& path, float scale);
+
+	// Maps a file written by save and uploads its vertex & index blobs directly
+	bool load(const std::string& path);
+
+	void render(MatrixStack* matrix, Shader* shader, Texture* texture, float scale);
+
+	CubeModel(const CubeModel& other) = delete;
+
+	CubeModel& operator=(const CubeModel& other) = delete;
+};
@@ -23,7 +23,7 @@ void MeshBase::drawElements(const Texture& texture)
 	glBindVertexArray(m_VAO);
 	texture.bind(0);
 
-	glDrawElements(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, 0);
+	glDrawRangeElements(GL_TRIANGLES, 0, m_maxIndex, m_indices.size(), m_indexType, 0);
 
 	texture.unbind();
 	glBindVertexArray(0);
@@ -31,19 +31,19 @@ void MeshBase::drawElements(const Texture& texture)
 
 void Mesh::calculateNormals()
 {
-	for (int i = 0; i < m_vertices.size(); i += 4)
+	for (size_t i = 0; i + 3 < m_vertices.size(); i += 4)
 	{
-		std::vector<Vertex> face = std::vector<Vertex>(m_vertices.begin() + i, m_vertices.begin() + i + 4);
+		Vertex* face = &m_vertices[i];
 
 		Vec3<float> v1 = { face[1].x - face[0].x, face[1].y - face[0].y, face[1].z - face[0].z };
 		Vec3<float> v2 = { face[3].x - face[0].x, face[3].y - face[0].y, face[3].z - face[0].z };
 		auto normal = v1.cross(v2).normalize();
 
-		for (auto& v : face)
+		for (int j = 0; j < 4; ++j)
 		{
-			v.normX = normal.x;
-			v.normY = normal.y;
-			v.normZ = normal.z;
+			face[j].normX = normal.x;
+			face[j].normY = normal.y;
+			face[j].normZ = normal.z;
 		}
 	}
 }
@@ -63,6 +63,27 @@ void Mesh::calculateIndices()
 	}
 }
 
+MeshOptimizer::Stats Mesh::optimize()
+{
+	MeshOptimizer::Stats stats;
+	stats.verticesBefore = m_vertices.size();
+	stats.acmrBefore = MeshOptimizer::computeACMR(m_indices, m_vertices.size());
+
+	if (m_indices.empty())
+	{
+		return stats;
+	}
+
+	MeshOptimizer::weldVertices(m_vertices, m_indices);
+	MeshOptimizer::optimizeVertexCache(m_indices, m_vertices.size());
+	MeshOptimizer::optimizeOverdraw(m_indices, &m_vertices[0].x, sizeof(Vertex), m_vertices.size());
+	MeshOptimizer::optimizeVertexFetch(m_vertices, m_indices);
+
+	stats.verticesAfter = m_vertices.size();
+	stats.acmrAfter = MeshOptimizer::computeACMR(m_indices, m_vertices.size());
+	return stats;
+}
+
 void Mesh::vertexUV(float x, float y, float z, float u, float v)
 {
 	m_vertices.emplace_back(x, y, z, u, v);
@@ -1,6 +1,7 @@
 #pragma once
 #include <vector>
 #include "../graphics/texture.h"
+#include "meshoptimizer.h"
 
 class MeshBase
 {
@@ -8,6 +9,10 @@ protected:
 	unsigned int m_VBO, m_VAO, m_EBO;
 	bool m_loaded = false;
 
+	// Set from BufferBuilder when the index buffer is uploaded
+	unsigned int m_indexType = 0x1405; // GL_UNSIGNED_INT
+	unsigned int m_maxIndex = 0;
+
 	void unload();
 
 	std::vector<unsigned int> m_indices;
@@ -37,6 +42,9 @@ protected:
 
 	void calculateIndices();
 
+	// Welds shared vertices and reorders for the vertex cache & overdraw, run after the normals are in
+	MeshOptimizer::Stats optimize();
+
 	void vertexUV(float x, float y, float z, float u, float v);
 
 public:
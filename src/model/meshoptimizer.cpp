@@ -0,0 +1,325 @@
+#include "meshoptimizer.h"
+#include <algorithm>
+#include <cmath>
+
+// https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+constexpr int FORSYTH_CACHE_SIZE = 32;
+constexpr float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+constexpr float FORSYTH_LAST_TRI_SCORE = 0.75f;
+constexpr float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+constexpr float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+static float forsythScore(int cachePosition, unsigned int remainingTriangles)
+{
+	if (remainingTriangles == 0)
+	{
+		return -1.0f;
+	}
+
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		if (cachePosition < 3)
+		{
+			// The last triangle's vertices get a fixed score so it isn't favoured too much
+			score = FORSYTH_LAST_TRI_SCORE;
+		}
+		else
+		{
+			const float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+			score = std::pow(1.0f - (cachePosition - 3) * scaler, FORSYTH_CACHE_DECAY_POWER);
+		}
+	}
+
+	// Boost vertices with few triangles left so they get finished off
+	score += FORSYTH_VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingTriangles), -FORSYTH_VALENCE_BOOST_POWER);
+	return score;
+}
+
+float MeshOptimizer::computeACMR(const std::vector<unsigned int>& indices, size_t vertexCount, size_t cacheSize)
+{
+	if (indices.size() < 3)
+	{
+		return 0.0f;
+	}
+
+	// FIFO cache, a vertex is a hit if it was pushed within the last cacheSize misses
+	std::vector<size_t> timestamps(vertexCount, 0);
+	size_t time = cacheSize + 1;
+	size_t misses = 0;
+
+	for (unsigned int index : indices)
+	{
+		if (time - timestamps[index] > cacheSize)
+		{
+			timestamps[index] = time++;
+			misses++;
+		}
+	}
+
+	return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount)
+{
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// Vertex -> triangle adjacency, stored as offsets into one flat array
+	std::vector<unsigned int> remaining(vertexCount, 0);
+	for (unsigned int index : indices)
+	{
+		remaining[index]++;
+	}
+
+	std::vector<unsigned int> offsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		offsets[v + 1] = offsets[v] + remaining[v];
+	}
+
+	std::vector<unsigned int> adjacency(indices.size());
+	std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			adjacency[fill[indices[t * 3 + k]]++] = static_cast<unsigned int>(t);
+		}
+	}
+
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		vertexScore[v] = forsythScore(-1, remaining[v]);
+	}
+
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+	}
+
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+
+	// Extra room for the three vertices pushed before the cache is trimmed
+	std::vector<unsigned int> cache;
+	std::vector<unsigned int> newCache;
+	cache.reserve(FORSYTH_CACHE_SIZE + 3);
+	newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+	size_t scanCursor = 0;
+
+	for (size_t step = 0; step < triangleCount; ++step)
+	{
+		// Best candidate touching the cache
+		long long best = -1;
+		float bestScore = -1.0f;
+		for (unsigned int v : cache)
+		{
+			for (unsigned int a = offsets[v]; a < offsets[v + 1]; ++a)
+			{
+				unsigned int t = adjacency[a];
+				if (!emitted[t] && triangleScore[t] > bestScore)
+				{
+					best = t;
+					bestScore = triangleScore[t];
+				}
+			}
+		}
+
+		// Nothing left around the cache, jump to the next unused triangle
+		if (best < 0)
+		{
+			while (emitted[scanCursor])
+			{
+				scanCursor++;
+			}
+			best = static_cast<long long>(scanCursor);
+		}
+
+		emitted[best] = true;
+
+		newCache.clear();
+		for (int k = 0; k < 3; ++k)
+		{
+			unsigned int v = indices[best * 3 + k];
+			result.push_back(v);
+			remaining[v]--;
+			newCache.push_back(v);
+		}
+
+		for (unsigned int v : cache)
+		{
+			if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+			{
+				newCache.push_back(v);
+			}
+		}
+
+		// Score every vertex by its new cache slot, anything pushed out drops its cache score.
+		// The pushed out vertices stay in newCache until their triangles are refreshed
+		for (size_t i = 0; i < newCache.size(); ++i)
+		{
+			int slot = (i < FORSYTH_CACHE_SIZE) ? static_cast<int>(i) : -1;
+			vertexScore[newCache[i]] = forsythScore(slot, remaining[newCache[i]]);
+		}
+
+		for (unsigned int v : newCache)
+		{
+			for (unsigned int a = offsets[v]; a < offsets[v + 1]; ++a)
+			{
+				unsigned int t = adjacency[a];
+				if (!emitted[t])
+				{
+					triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+				}
+			}
+		}
+
+		if (newCache.size() > FORSYTH_CACHE_SIZE)
+		{
+			newCache.resize(FORSYTH_CACHE_SIZE);
+		}
+
+		cache.swap(newCache);
+	}
+
+	indices.swap(result);
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<unsigned int>& indices, const float* positions, size_t stride, size_t vertexCount, float threshold)
+{
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount < 2)
+	{
+		return;
+	}
+
+	auto position = [&](unsigned int v)
+	{
+		return reinterpret_cast<const float*>(reinterpret_cast<const unsigned char*>(positions) + v * stride);
+	};
+
+	const float acmr = computeACMR(indices, vertexCount);
+
+	// Split wherever a triangle misses on all three vertices, the cache restarts there anyway
+	std::vector<size_t> clusters;
+	{
+		const size_t cacheSize = 16;
+		std::vector<size_t> timestamps(vertexCount, 0);
+		size_t time = cacheSize + 1;
+
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			int misses = 0;
+			for (int k = 0; k < 3; ++k)
+			{
+				unsigned int v = indices[t * 3 + k];
+				if (time - timestamps[v] > cacheSize)
+				{
+					timestamps[v] = time++;
+					misses++;
+				}
+			}
+
+			if (t == 0 || misses == 3)
+			{
+				clusters.push_back(t);
+			}
+		}
+	}
+
+	if (clusters.size() < 2)
+	{
+		return;
+	}
+
+	float meshCenter[3] = { 0.0f, 0.0f, 0.0f };
+	for (unsigned int index : indices)
+	{
+		const float* p = position(index);
+		meshCenter[0] += p[0]; meshCenter[1] += p[1]; meshCenter[2] += p[2];
+	}
+	for (float& c : meshCenter)
+	{
+		c /= static_cast<float>(indices.size());
+	}
+
+	// Sort key is how far the cluster faces away from the middle of the mesh
+	struct Cluster
+	{
+		size_t first, last;
+		float key;
+	};
+
+	std::vector<Cluster> sorted;
+	sorted.reserve(clusters.size());
+
+	for (size_t c = 0; c < clusters.size(); ++c)
+	{
+		size_t first = clusters[c];
+		size_t last = (c + 1 < clusters.size()) ? clusters[c + 1] : triangleCount;
+
+		float center[3] = { 0.0f, 0.0f, 0.0f };
+		float normal[3] = { 0.0f, 0.0f, 0.0f };
+		float area = 0.0f;
+
+		for (size_t t = first; t < last; ++t)
+		{
+			const float* a = position(indices[t * 3]);
+			const float* b = position(indices[t * 3 + 1]);
+			const float* d = position(indices[t * 3 + 2]);
+
+			float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			float e2[3] = { d[0] - a[0], d[1] - a[1], d[2] - a[2] };
+			float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			float w = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+			// Area weighted, the cross product length is already twice the area
+			for (int k = 0; k < 3; ++k)
+			{
+				center[k] += (a[k] + b[k] + d[k]) * (w / 3.0f);
+				normal[k] += n[k];
+			}
+			area += w;
+		}
+
+		float key = 0.0f;
+		if (area > 0.0f)
+		{
+			float nlen = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			if (nlen > 0.0f)
+			{
+				for (int k = 0; k < 3; ++k)
+				{
+					key += (center[k] / area - meshCenter[k]) * (normal[k] / nlen);
+				}
+			}
+		}
+
+		sorted.push_back({ first, last, key });
+	}
+
+	std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b)
+	{
+		return a.key > b.key;
+	});
+
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+	for (const Cluster& cluster : sorted)
+	{
+		result.insert(result.end(), indices.begin() + cluster.first * 3, indices.begin() + cluster.last * 3);
+	}
+
+	if (computeACMR(result, vertexCount) <= acmr * threshold)
+	{
+		indices.swap(result);
+	}
+}
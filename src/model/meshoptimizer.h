@@ -0,0 +1,145 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <cstring>
+#include <cstddef>
+
+// Index buffer processing used when meshes are baked. Every pass works on plain
+// triangle lists so it can run on any vertex layout.
+namespace MeshOptimizer
+{
+	struct Stats
+	{
+		size_t verticesBefore = 0;
+		size_t verticesAfter = 0;
+
+		// Average cache miss ratio, transformed vertices per triangle (0.5 is ideal, 3 is worst)
+		float acmrBefore = 0.0f;
+		float acmrAfter = 0.0f;
+	};
+
+	// Simulates a FIFO post-transform cache of the given size
+	float computeACMR(const std::vector<unsigned int>& indices, size_t vertexCount, size_t cacheSize = 16);
+
+	// Forsyth's linear-speed vertex cache optimisation, reorders triangles in place
+	void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount);
+
+	// Reorders clusters of the cache-optimised list so outward facing ones draw first.
+	// Clusters are only split where the cache already restarted, and the new order
+	// is dropped if it pushes the ACMR over threshold times the original
+	void optimizeOverdraw(std::vector<unsigned int>& indices, const float* positions, size_t stride, size_t vertexCount, float threshold = 1.05f);
+
+	// Rewrites indices to remap and moves vertices into their new slots, dropping unused ones
+	template<typename T>
+	void remapVertices(std::vector<T>& vertices, std::vector<unsigned int>& indices, const std::vector<unsigned int>& remap, size_t uniqueCount)
+	{
+		std::vector<T> result;
+		result.reserve(uniqueCount);
+
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			if (remap[i] == result.size())
+			{
+				result.push_back(vertices[i]);
+			}
+		}
+
+		for (auto& index : indices)
+		{
+			index = remap[index];
+		}
+
+		vertices = std::move(result);
+	}
+
+	// Merges bitwise identical vertices, T has to be a plain struct without padding
+	template<typename T>
+	size_t weldVertices(std::vector<T>& vertices, std::vector<unsigned int>& indices)
+	{
+		const size_t count = vertices.size();
+
+		auto hashVertex = [](const T& v)
+		{
+			// FNV-1a over the raw bytes
+			const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&v);
+			size_t hash = 14695981039346656037ull;
+			for (size_t i = 0; i < sizeof(T); ++i)
+			{
+				hash = (hash ^ bytes[i]) * 1099511628211ull;
+			}
+			return hash;
+		};
+
+		std::unordered_multimap<size_t, unsigned int> seen;
+		seen.reserve(count);
+
+		std::vector<unsigned int> remap(count);
+		unsigned int unique = 0;
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			size_t hash = hashVertex(vertices[i]);
+			unsigned int target = unique;
+
+			auto range = seen.equal_range(hash);
+			for (auto it = range.first; it != range.second; ++it)
+			{
+				if (std::memcmp(&vertices[it->second], &vertices[i], sizeof(T)) == 0)
+				{
+					target = remap[it->second];
+					break;
+				}
+			}
+
+			if (target == unique)
+			{
+				seen.emplace(hash, static_cast<unsigned int>(i));
+				unique++;
+			}
+
+			remap[i] = target;
+		}
+
+		remapVertices(vertices, indices, remap, unique);
+		return unique;
+	}
+
+	// Orders vertices by first use so vertex fetches walk memory linearly
+	template<typename T>
+	void optimizeVertexFetch(std::vector<T>& vertices, std::vector<unsigned int>& indices)
+	{
+		if (indices.empty())
+		{
+			return;
+		}
+
+		const unsigned int unused = ~0u;
+		std::vector<unsigned int> remap(vertices.size(), unused);
+		unsigned int next = 0;
+
+		for (unsigned int index : indices)
+		{
+			if (remap[index] == unused)
+			{
+				remap[index] = next++;
+			}
+		}
+
+		std::vector<T> result(next, vertices[0]);
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			if (remap[i] != unused)
+			{
+				result[remap[i]] = vertices[i];
+			}
+		}
+
+		for (auto& index : indices)
+		{
+			index = remap[index];
+		}
+
+		vertices = std::move(result);
+	}
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+
 struct AABB
 {
     double minX, minY, minZ;
@@ -12,4 +14,31 @@ struct AABB
             (minY <= other.maxY && maxY >= other.minY) &&
             (minZ <= other.maxZ && maxZ >= other.minZ);
     }
-};
\ No newline at end of file
+
+    bool contains(const AABB& other) const
+    {
+        return
+            minX <= other.minX && minY <= other.minY && minZ <= other.minZ &&
+            maxX >= other.maxX && maxY >= other.maxY && maxZ >= other.maxZ;
+    }
+
+    AABB merge(const AABB& other) const
+    {
+        return
+        {
+            std::min(minX, other.minX), std::min(minY, other.minY), std::min(minZ, other.minZ),
+            std::max(maxX, other.maxX), std::max(maxY, other.maxY), std::max(maxZ, other.maxZ)
+        };
+    }
+
+    AABB grow(double amount) const
+    {
+        return { minX - amount, minY - amount, minZ - amount, maxX + amount, maxY + amount, maxZ + amount };
+    }
+
+    double surfaceArea() const
+    {
+        double x = maxX - minX, y = maxY - minY, z = maxZ - minZ;
+        return 2.0 * (x * y + y * z + z * x);
+    }
+};
@@ -0,0 +1,321 @@
+#include "aabbtree.h"
+#include <algorithm>
+
+int AABBTree::allocateNode()
+{
+    if (m_freeList == NULL_NODE)
+    {
+        // Grow the pool and thread the new nodes onto the free list
+        int first = static_cast<int>(m_nodes.size());
+        int count = std::max(16, first);
+        m_nodes.resize(first + count);
+
+        for (int i = first; i < first + count - 1; ++i)
+        {
+            m_nodes[i].next = i + 1;
+            m_nodes[i].height = -1;
+        }
+        m_nodes[first + count - 1].next = NULL_NODE;
+        m_nodes[first + count - 1].height = -1;
+
+        m_freeList = first;
+    }
+
+    int id = m_freeList;
+    Node& node = m_nodes[id];
+    m_freeList = node.next;
+
+    node.parent = NULL_NODE;
+    node.child1 = NULL_NODE;
+    node.child2 = NULL_NODE;
+    node.height = 0;
+    node.userData = 0;
+    return id;
+}
+
+void AABBTree::freeNode(int node)
+{
+    m_nodes[node].next = m_freeList;
+    m_nodes[node].height = -1;
+    m_freeList = node;
+}
+
+int AABBTree::insert(const AABB& box, uint32_t userData)
+{
+    int proxy = allocateNode();
+
+    Node& node = m_nodes[proxy];
+    node.box = box.grow(FAT_MARGIN);
+    node.tightBox = box;
+    node.userData = userData;
+
+    insertLeaf(proxy);
+    m_proxyCount++;
+    return proxy;
+}
+
+void AABBTree::remove(int proxy)
+{
+    removeLeaf(proxy);
+    freeNode(proxy);
+    m_proxyCount--;
+}
+
+bool AABBTree::move(int proxy, const AABB& box, const Vec3<double>& displacement)
+{
+    Node& node = m_nodes[proxy];
+    node.tightBox = box;
+
+    if (node.box.contains(box))
+    {
+        return false;
+    }
+
+    // Stretch the fat box in the direction of travel so it lasts a few more ticks
+    AABB fat = box.grow(FAT_MARGIN);
+    Vec3<double> d = { displacement.x * DISPLACEMENT_MULTIPLIER, displacement.y * DISPLACEMENT_MULTIPLIER, displacement.z * DISPLACEMENT_MULTIPLIER };
+
+    if (d.x < 0.0) fat.minX += d.x; else fat.maxX += d.x;
+    if (d.y < 0.0) fat.minY += d.y; else fat.maxY += d.y;
+    if (d.z < 0.0) fat.minZ += d.z; else fat.maxZ += d.z;
+
+    removeLeaf(proxy);
+    m_nodes[proxy].box = fat;
+    insertLeaf(proxy);
+    return true;
+}
+
+void AABBTree::insertLeaf(int leaf)
+{
+    if (m_root == NULL_NODE)
+    {
+        m_root = leaf;
+        m_nodes[leaf].parent = NULL_NODE;
+        return;
+    }
+
+    // Walk down to the sibling that grows the total surface area the least
+    const AABB leafBox = m_nodes[leaf].box;
+    int index = m_root;
+
+    while (!m_nodes[index].isLeaf())
+    {
+        const Node& node = m_nodes[index];
+        int child1 = node.child1;
+        int child2 = node.child2;
+
+        double area = node.box.surfaceArea();
+        double combinedArea = node.box.merge(leafBox).surfaceArea();
+
+        // Cost of making a new parent for this node and the leaf
+        double cost = 2.0 * combinedArea;
+
+        // Minimum cost of pushing the leaf further down
+        double inheritanceCost = 2.0 * (combinedArea - area);
+
+        auto descendCost = [&](int child)
+        {
+            const AABB merged = leafBox.merge(m_nodes[child].box);
+            if (m_nodes[child].isLeaf())
+            {
+                return merged.surfaceArea() + inheritanceCost;
+            }
+            return merged.surfaceArea() - m_nodes[child].box.surfaceArea() + inheritanceCost;
+        };
+
+        double cost1 = descendCost(child1);
+        double cost2 = descendCost(child2);
+
+        if (cost < cost1 && cost < cost2)
+        {
+            break;
+        }
+
+        index = (cost1 < cost2) ? child1 : child2;
+    }
+
+    int sibling = index;
+
+    int oldParent = m_nodes[sibling].parent;
+    int newParent = allocateNode();
+    m_nodes[newParent].parent = oldParent;
+    m_nodes[newParent].box = leafBox.merge(m_nodes[sibling].box);
+    m_nodes[newParent].height = m_nodes[sibling].height + 1;
+    m_nodes[newParent].child1 = sibling;
+    m_nodes[newParent].child2 = leaf;
+    m_nodes[sibling].parent = newParent;
+    m_nodes[leaf].parent = newParent;
+
+    if (oldParent != NULL_NODE)
+    {
+        if (m_nodes[oldParent].child1 == sibling)
+        {
+            m_nodes[oldParent].child1 = newParent;
+        }
+        else
+        {
+            m_nodes[oldParent].child2 = newParent;
+        }
+    }
+    else
+    {
+        m_root = newParent;
+    }
+
+    // Refit and rebalance on the way back up
+    index = m_nodes[leaf].parent;
+    while (index != NULL_NODE)
+    {
+        index = balance(index);
+
+        Node& node = m_nodes[index];
+        node.height = 1 + std::max(m_nodes[node.child1].height, m_nodes[node.child2].height);
+        node.box = m_nodes[node.child1].box.merge(m_nodes[node.child2].box);
+
+        index = node.parent;
+    }
+}
+
+void AABBTree::removeLeaf(int leaf)
+{
+    if (leaf == m_root)
+    {
+        m_root = NULL_NODE;
+        return;
+    }
+
+    int parent = m_nodes[leaf].parent;
+    int grandParent = m_nodes[parent].parent;
+    int sibling = (m_nodes[parent].child1 == leaf) ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+    if (grandParent == NULL_NODE)
+    {
+        m_root = sibling;
+        m_nodes[sibling].parent = NULL_NODE;
+        freeNode(parent);
+        return;
+    }
+
+    // The sibling takes the parent's place
+    if (m_nodes[grandParent].child1 == parent)
+    {
+        m_nodes[grandParent].child1 = sibling;
+    }
+    else
+    {
+        m_nodes[grandParent].child2 = sibling;
+    }
+    m_nodes[sibling].parent = grandParent;
+    freeNode(parent);
+
+    int index = grandParent;
+    while (index != NULL_NODE)
+    {
+        index = balance(index);
+
+        Node& node = m_nodes[index];
+        node.box = m_nodes[node.child1].box.merge(m_nodes[node.child2].box);
+        node.height = 1 + std::max(m_nodes[node.child1].height, m_nodes[node.child2].height);
+
+        index = node.parent;
+    }
+}
+
+// Rotates the taller child of a up if the two sides differ in height by more
+// than one. Returns the index of the node now sitting where a was
+int AABBTree::balance(int a)
+{
+    Node& nodeA = m_nodes[a];
+    if (nodeA.isLeaf() || nodeA.height < 2)
+    {
+        return a;
+    }
+
+    int b = nodeA.child1;
+    int c = nodeA.child2;
+    int difference = m_nodes[c].height - m_nodes[b].height;
+
+    if (difference > 1 || difference < -1)
+    {
+        // The taller child becomes the new root of this subtree
+        bool rotateC = difference > 1;
+        int up = rotateC ? c : b;
+        int other = rotateC ? b : c;
+
+        Node& nodeUp = m_nodes[up];
+        int f = nodeUp.child1;
+        int g = nodeUp.child2;
+
+        nodeUp.child1 = a;
+        nodeUp.parent = nodeA.parent;
+        nodeA.parent = up;
+
+        if (nodeUp.parent != NULL_NODE)
+        {
+            if (m_nodes[nodeUp.parent].child1 == a)
+            {
+                m_nodes[nodeUp.parent].child1 = up;
+            }
+            else
+            {
+                m_nodes[nodeUp.parent].child2 = up;
+            }
+        }
+        else
+        {
+            m_root = up;
+        }
+
+        // The taller grandchild stays with the risen node, the shorter one moves under a
+        int keep = (m_nodes[f].height > m_nodes[g].height) ? f : g;
+        int give = (keep == f) ? g : f;
+
+        nodeUp.child2 = keep;
+        if (rotateC)
+        {
+            nodeA.child2 = give;
+        }
+        else
+        {
+            nodeA.child1 = give;
+        }
+        m_nodes[give].parent = a;
+
+        nodeA.box = m_nodes[other].box.merge(m_nodes[give].box);
+        nodeA.height = 1 + std::max(m_nodes[other].height, m_nodes[give].height);
+
+        nodeUp.box = nodeA.box.merge(m_nodes[keep].box);
+        nodeUp.height = 1 + std::max(nodeA.height, m_nodes[keep].height);
+
+        return up;
+    }
+
+    return a;
+}
+
+void AABBTree::queryPairs(std::vector<std::pair<int, int>>& pairs) const
+{
+    pairs.clear();
+
+    for (int id = 0; id < static_cast<int>(m_nodes.size()); ++id)
+    {
+        const Node& node = m_nodes[id];
+        if (node.height != 0)
+        {
+            continue;
+        }
+
+        const AABB& box = node.tightBox;
+        query(box, [&](int other)
+        {
+            // Each pair is found from both sides, keep it from the lower id only
+            if (other > id && m_nodes[other].tightBox.overlaps(box))
+            {
+                pairs.emplace_back(id, other);
+            }
+            return true;
+        });
+    }
+
+    std::sort(pairs.begin(), pairs.end());
+}
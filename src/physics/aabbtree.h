@@ -0,0 +1,205 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cmath>
+#include "aabb.h"
+#include "../utility/vec.h"
+
+// Dynamic AABB tree broadphase. Proxies are stored with a fattened box so small
+// movements don't touch the tree, and the tree is kept balanced with rotations
+// as leaves are inserted and removed
+class AABBTree
+{
+public:
+    static constexpr int NULL_NODE = -1;
+
+    // How far the stored box reaches past the real one on every side
+    static constexpr double FAT_MARGIN = 0.1;
+
+    // Fraction of a move's displacement the fat box is stretched by ahead of time
+    static constexpr double DISPLACEMENT_MULTIPLIER = 4.0;
+
+private:
+    struct Node
+    {
+        AABB box;
+
+        // The box that was actually inserted, for exact pair tests
+        AABB tightBox;
+
+        union
+        {
+            int parent;
+            int next;
+        };
+
+        int child1;
+        int child2;
+
+        // Leaf = 0, free node = -1
+        int height;
+
+        uint32_t userData;
+
+        bool isLeaf() const { return child1 == NULL_NODE; }
+    };
+
+    std::vector<Node> m_nodes;
+    int m_root = NULL_NODE;
+    int m_freeList = NULL_NODE;
+    size_t m_proxyCount = 0;
+
+    // Scratch stack reused by the queries
+    mutable std::vector<int> m_stack;
+
+    int allocateNode();
+
+    void freeNode(int node);
+
+    void insertLeaf(int leaf);
+
+    void removeLeaf(int leaf);
+
+    int balance(int node);
+
+public:
+    AABBTree() = default;
+
+    // Returns the proxy id used to move, remove and identify the box in queries
+    int insert(const AABB& box, uint32_t userData);
+
+    void remove(int proxy);
+
+    // Returns true when the box left its fat box and had to be reinserted
+    bool move(int proxy, const AABB& box, const Vec3<double>& displacement = {});
+
+    uint32_t getUserData(int proxy) const
+    {
+        return m_nodes[proxy].userData;
+    }
+
+    const AABB& getFatBox(int proxy) const
+    {
+        return m_nodes[proxy].box;
+    }
+
+    const AABB& getBox(int proxy) const
+    {
+        return m_nodes[proxy].tightBox;
+    }
+
+    int getHeight() const
+    {
+        return m_root == NULL_NODE ? 0 : m_nodes[m_root].height;
+    }
+
+    size_t getProxyCount() const
+    {
+        return m_proxyCount;
+    }
+
+    // Every proxy whose real box overlaps any other's, each pair once as (lower id, higher id)
+    // and sorted, so the list comes out the same every tick for the same world
+    void queryPairs(std::vector<std::pair<int, int>>& pairs) const;
+
+    // callback(int proxy) for every proxy whose fat box overlaps, return false to stop
+    template<typename Callback>
+    void query(const AABB& box, Callback&& callback) const
+    {
+        if (m_root == NULL_NODE)
+        {
+            return;
+        }
+
+        size_t base = m_stack.size();
+        m_stack.push_back(m_root);
+
+        while (m_stack.size() > base)
+        {
+            int id = m_stack.back();
+            m_stack.pop_back();
+
+            const Node& node = m_nodes[id];
+            if (!node.box.overlaps(box))
+            {
+                continue;
+            }
+
+            if (node.isLeaf())
+            {
+                if (!callback(id))
+                {
+                    break;
+                }
+            }
+            else
+            {
+                m_stack.push_back(node.child1);
+                m_stack.push_back(node.child2);
+            }
+        }
+
+        m_stack.resize(base);
+    }
+
+    // callback(int proxy, double maxDistance) for every proxy whose fat box the ray crosses
+    // within maxDistance. It returns the new max distance to clip the ray to, or 0 to stop
+    template<typename Callback>
+    void queryRay(const Vec3<double>& origin, const Vec3<double>& direction, double maxDistance, Callback&& callback) const
+    {
+        if (m_root == NULL_NODE)
+        {
+            return;
+        }
+
+        const double invX = 1.0 / direction.x, invY = 1.0 / direction.y, invZ = 1.0 / direction.z;
+
+        auto hit = [&](const AABB& b)
+        {
+            // Slab test, the infinities from axis aligned rays fall out of the min/max
+            double t1 = (b.minX - origin.x) * invX, t2 = (b.maxX - origin.x) * invX;
+            double tmin = std::min(t1, t2), tmax = std::max(t1, t2);
+
+            t1 = (b.minY - origin.y) * invY; t2 = (b.maxY - origin.y) * invY;
+            tmin = std::max(tmin, std::min(t1, t2)); tmax = std::min(tmax, std::max(t1, t2));
+
+            t1 = (b.minZ - origin.z) * invZ; t2 = (b.maxZ - origin.z) * invZ;
+            tmin = std::max(tmin, std::min(t1, t2)); tmax = std::min(tmax, std::max(t1, t2));
+
+            return tmax >= std::max(tmin, 0.0) && tmin <= maxDistance;
+        };
+
+        size_t base = m_stack.size();
+        m_stack.push_back(m_root);
+
+        while (m_stack.size() > base)
+        {
+            int id = m_stack.back();
+            m_stack.pop_back();
+
+            const Node& node = m_nodes[id];
+            if (!hit(node.box))
+            {
+                continue;
+            }
+
+            if (node.isLeaf())
+            {
+                maxDistance = callback(id, maxDistance);
+                if (maxDistance <= 0.0)
+                {
+                    break;
+                }
+            }
+            else
+            {
+                m_stack.push_back(node.child1);
+                m_stack.push_back(node.child2);
+            }
+        }
+
+        m_stack.resize(base);
+    }
+};
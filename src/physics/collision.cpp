@@ -0,0 +1,84 @@
+#include "collision.h"
+#include "../utility/threadpool.h"
+#include <algorithm>
+
+// Member pointers let the three axes share one clipping routine
+static double AABB::* const MIN[3] = { &AABB::minX, &AABB::minY, &AABB::minZ };
+static double AABB::* const MAX[3] = { &AABB::maxX, &AABB::maxY, &AABB::maxZ };
+
+// How far box can move along axis before touching other, or offset if nothing is in the way
+static double clipAxis(const AABB& box, const AABB& other, int axis, double offset)
+{
+    // Boxes have to overlap on the other two axes to ever touch
+    for (int i = 0; i < 3; ++i)
+    {
+        if (i != axis && (other.*MAX[i] <= box.*MIN[i] || other.*MIN[i] >= box.*MAX[i]))
+        {
+            return offset;
+        }
+    }
+
+    if (offset > 0.0 && other.*MIN[axis] >= box.*MAX[axis])
+    {
+        offset = std::min(offset, other.*MIN[axis] - box.*MAX[axis]);
+    }
+    else if (offset < 0.0 && other.*MAX[axis] <= box.*MIN[axis])
+    {
+        offset = std::max(offset, other.*MAX[axis] - box.*MIN[axis]);
+    }
+
+    return offset;
+}
+
+void Collision::moveAndCollide(const BlockCollider& world, Mover& mover, std::vector<AABB>& scratch)
+{
+    const Vec3<double> wanted = mover.velocity;
+
+    // Everything the box could touch anywhere along its path
+    AABB swept = mover.box;
+    (wanted.x < 0.0 ? swept.minX : swept.maxX) += wanted.x;
+    (wanted.y < 0.0 ? swept.minY : swept.maxY) += wanted.y;
+    (wanted.z < 0.0 ? swept.minZ : swept.maxZ) += wanted.z;
+
+    scratch.clear();
+    world.getBoxes(swept, scratch);
+
+    double move[3] = { wanted.x, wanted.y, wanted.z };
+
+    // Vertical first so walking off a ledge and landing resolve the way players expect
+    static const int order[3] = { 1, 0, 2 };
+
+    for (int axis : order)
+    {
+        if (move[axis] == 0.0)
+        {
+            continue;
+        }
+
+        for (const AABB& other : scratch)
+        {
+            move[axis] = clipAxis(mover.box, other, axis, move[axis]);
+        }
+
+        mover.box.*MIN[axis] += move[axis];
+        mover.box.*MAX[axis] += move[axis];
+    }
+
+    mover.collidedHorizontally = (move[0] != wanted.x) || (move[2] != wanted.z);
+    mover.collidedVertically = (move[1] != wanted.y);
+    mover.onGround = mover.collidedVertically && wanted.y < 0.0;
+
+    mover.velocity = { move[0], move[1], move[2] };
+}
+
+void Collision::moveAndCollide(const BlockCollider& world, Mover* movers, size_t count, ThreadPool& pool)
+{
+    pool.parallelFor(count, 256, [&](size_t begin, size_t end)
+    {
+        std::vector<AABB> scratch;
+        for (size_t i = begin; i < end; ++i)
+        {
+            moveAndCollide(world, movers[i], scratch);
+        }
+    });
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include "aabb.h"
+#include "../utility/vec.h"
+
+class ThreadPool;
+
+// Read only view of the solid geometry entities collide with. Implementations
+// have to be safe to call from several threads at once
+class BlockCollider
+{
+public:
+    virtual ~BlockCollider() = default;
+
+    // Appends the box of every solid block overlapping region
+    virtual void getBoxes(const AABB& region, std::vector<AABB>& boxes) const = 0;
+};
+
+// Full cube blocks, isSolid(int x, int y, int z) decides which cells are filled
+template<typename IsSolid>
+class SolidBlockCollider : public BlockCollider
+{
+private:
+    IsSolid m_isSolid;
+
+public:
+    SolidBlockCollider(IsSolid isSolid) : m_isSolid(isSolid) {}
+
+    void getBoxes(const AABB& region, std::vector<AABB>& boxes) const override
+    {
+        int x0 = static_cast<int>(std::floor(region.minX)), x1 = static_cast<int>(std::floor(region.maxX));
+        int y0 = static_cast<int>(std::floor(region.minY)), y1 = static_cast<int>(std::floor(region.maxY));
+        int z0 = static_cast<int>(std::floor(region.minZ)), z1 = static_cast<int>(std::floor(region.maxZ));
+
+        for (int y = y0; y <= y1; ++y)
+        {
+            for (int z = z0; z <= z1; ++z)
+            {
+                for (int x = x0; x <= x1; ++x)
+                {
+                    if (m_isSolid(x, y, z))
+                    {
+                        boxes.push_back({ double(x), double(y), double(z), x + 1.0, y + 1.0, z + 1.0 });
+                    }
+                }
+            }
+        }
+    }
+};
+
+namespace Collision
+{
+    struct Mover
+    {
+        AABB box;
+
+        // Displacement wanted this tick, clipped to what was actually moved
+        Vec3<double> velocity;
+
+        bool onGround = false;
+        bool collidedHorizontally = false;
+        bool collidedVertically = false;
+    };
+
+    // Sweeps the box through velocity one axis at a time (Y, then X, then Z) against every
+    // block in the swept region, so nothing is skipped no matter how fast the box moves.
+    // scratch is reused between calls to avoid allocating
+    void moveAndCollide(const BlockCollider& world, Mover& mover, std::vector<AABB>& scratch);
+
+    // Resolves every mover against the same read only world, split across the pool
+    void moveAndCollide(const BlockCollider& world, Mover* movers, size_t count, ThreadPool& pool);
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include "../utility/vec.h"
+#include "../utility/threadpool.h"
+
+// Amanatides & Woo voxel traversal, "A Fast Voxel Traversal Algorithm for Ray Tracing".
+// Visits every cell a ray passes through in order, without ever skipping one
+namespace VoxelRaycast
+{
+    struct Ray
+    {
+        Vec3<double> origin;
+        Vec3<double> direction;
+        double maxDistance;
+    };
+
+    struct Hit
+    {
+        bool hit = false;
+
+        Vec3<int> block;
+
+        // Outward normal of the face the ray came in through, zero if it started inside the block
+        Vec3<int> normal;
+
+        double distance = 0.0;
+        Vec3<double> position;
+    };
+
+    // visit(int x, int y, int z) is called for each cell along the ray and returns true to stop there
+    template<typename Visit>
+    Hit cast(const Ray& ray, Visit&& visit)
+    {
+        Hit result;
+
+        double length = std::sqrt(ray.direction.x * ray.direction.x + ray.direction.y * ray.direction.y + ray.direction.z * ray.direction.z);
+        if (length == 0.0)
+        {
+            return result;
+        }
+
+        const double dir[3] = { ray.direction.x / length, ray.direction.y / length, ray.direction.z / length };
+        const double origin[3] = { ray.origin.x, ray.origin.y, ray.origin.z };
+        constexpr double inf = std::numeric_limits<double>::infinity();
+
+        int cell[3], step[3];
+        double tMax[3], tDelta[3];
+
+        for (int i = 0; i < 3; ++i)
+        {
+            cell[i] = static_cast<int>(std::floor(origin[i]));
+
+            if (dir[i] > 0.0)
+            {
+                step[i] = 1;
+                tDelta[i] = 1.0 / dir[i];
+                tMax[i] = (cell[i] + 1.0 - origin[i]) * tDelta[i];
+            }
+            else if (dir[i] < 0.0)
+            {
+                step[i] = -1;
+                tDelta[i] = -1.0 / dir[i];
+                tMax[i] = (origin[i] - cell[i]) * tDelta[i];
+            }
+            else
+            {
+                step[i] = 0;
+                tDelta[i] = inf;
+                tMax[i] = inf;
+            }
+        }
+
+        int face = -1;
+        double t = 0.0;
+
+        while (t <= ray.maxDistance)
+        {
+            if (visit(cell[0], cell[1], cell[2]))
+            {
+                result.hit = true;
+                result.block = { cell[0], cell[1], cell[2] };
+                result.distance = t;
+                result.position = { origin[0] + dir[0] * t, origin[1] + dir[1] * t, origin[2] + dir[2] * t };
+
+                if (face >= 0)
+                {
+                    int normal[3] = { 0, 0, 0 };
+                    normal[face] = -step[face];
+                    result.normal = { normal[0], normal[1], normal[2] };
+                }
+                return result;
+            }
+
+            // Step into whichever neighbour the ray reaches first
+            face = (tMax[0] < tMax[1]) ? (tMax[0] < tMax[2] ? 0 : 2) : (tMax[1] < tMax[2] ? 1 : 2);
+
+            t = tMax[face];
+            cell[face] += step[face];
+            tMax[face] += tDelta[face];
+        }
+
+        result.distance = ray.maxDistance;
+        return result;
+    }
+
+    // Casts many rays against the same read only world across the pool, for AI sight checks,
+    // audio occlusion and the like. isSolid(int x, int y, int z) must be safe to call concurrently
+    template<typename IsSolid>
+    void castBatch(const Ray* rays, Hit* hits, size_t count, const IsSolid& isSolid, ThreadPool& pool)
+    {
+        pool.parallelFor(count, 64, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                hits[i] = cast(rays[i], isSolid);
+            }
+        });
+    }
+}
@@ -0,0 +1,266 @@
+#include "bvh.h"
+#include "frustum.h"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+using Clock = std::chrono::high_resolution_clock;
+
+static double elapsedMs(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static void grow(AABB& a, const AABB& b)
+{
+	a.minX = std::min(a.minX, b.minX); a.minY = std::min(a.minY, b.minY); a.minZ = std::min(a.minZ, b.minZ);
+	a.maxX = std::max(a.maxX, b.maxX); a.maxY = std::max(a.maxY, b.maxY); a.maxZ = std::max(a.maxZ, b.maxZ);
+}
+
+static AABB emptyBox()
+{
+	constexpr double inf = std::numeric_limits<double>::infinity();
+	return { inf, inf, inf, -inf, -inf, -inf };
+}
+
+static double surfaceArea(const AABB& a)
+{
+	double x = a.maxX - a.minX, y = a.maxY - a.minY, z = a.maxZ - a.minZ;
+	return (x < 0.0) ? 0.0 : 2.0 * (x * y + y * z + z * x);
+}
+
+void BVH::updateBounds(Node& node) const
+{
+	node.bounds = emptyBox();
+	for (uint32_t i = 0; i < node.count; ++i)
+	{
+		grow(node.bounds, m_boxes[m_items[node.first + i]]);
+	}
+}
+
+void BVH::build(const std::vector<AABB>& boxes)
+{
+	auto start = Clock::now();
+
+	m_boxes = boxes;
+	m_nodes.clear();
+	m_items.resize(boxes.size());
+
+	for (uint32_t i = 0; i < m_items.size(); ++i)
+	{
+		m_items[i] = i;
+	}
+
+	if (!boxes.empty())
+	{
+		// Centroids are stored per axis, doubled so the halving is skipped
+		std::vector<double> centroids(boxes.size() * 3);
+		for (size_t i = 0; i < boxes.size(); ++i)
+		{
+			centroids[i * 3] = boxes[i].minX + boxes[i].maxX;
+			centroids[i * 3 + 1] = boxes[i].minY + boxes[i].maxY;
+			centroids[i * 3 + 2] = boxes[i].minZ + boxes[i].maxZ;
+		}
+
+		m_nodes.reserve(boxes.size() * 2);
+		m_nodes.push_back({ emptyBox(), 0, 0, static_cast<uint32_t>(boxes.size()) });
+		updateBounds(m_nodes[0]);
+		subdivide(0, centroids);
+	}
+
+	m_stats.nodeCount = m_nodes.size();
+	m_stats.buildMs = elapsedMs(start);
+}
+
+void BVH::subdivide(uint32_t nodeIndex, std::vector<double>& centroids)
+{
+	Node node = m_nodes[nodeIndex];
+	if (node.count <= MAX_LEAF_SIZE)
+	{
+		return;
+	}
+
+	struct Bin
+	{
+		AABB bounds = emptyBox();
+		uint32_t count = 0;
+	};
+
+	double bestCost = std::numeric_limits<double>::infinity();
+	int bestAxis = -1;
+	int bestSplit = 0;
+	double bestMin = 0.0, bestScale = 0.0;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		double cmin = std::numeric_limits<double>::infinity(), cmax = -cmin;
+		for (uint32_t i = 0; i < node.count; ++i)
+		{
+			double c = centroids[m_items[node.first + i] * 3 + axis];
+			cmin = std::min(cmin, c);
+			cmax = std::max(cmax, c);
+		}
+
+		if (cmax <= cmin)
+		{
+			continue;
+		}
+
+		Bin bins[BIN_COUNT];
+		double scale = BIN_COUNT / (cmax - cmin);
+
+		for (uint32_t i = 0; i < node.count; ++i)
+		{
+			uint32_t item = m_items[node.first + i];
+			int b = std::min(BIN_COUNT - 1, static_cast<int>((centroids[item * 3 + axis] - cmin) * scale));
+			bins[b].count++;
+			grow(bins[b].bounds, m_boxes[item]);
+		}
+
+		// Sweep from both sides to get the area & count left and right of every split
+		double leftArea[BIN_COUNT - 1], rightArea[BIN_COUNT - 1];
+		uint32_t leftCount[BIN_COUNT - 1], rightCount[BIN_COUNT - 1];
+		AABB leftBox = emptyBox(), rightBox = emptyBox();
+		uint32_t leftSum = 0, rightSum = 0;
+
+		for (int i = 0; i < BIN_COUNT - 1; ++i)
+		{
+			leftSum += bins[i].count;
+			grow(leftBox, bins[i].bounds);
+			leftCount[i] = leftSum;
+			leftArea[i] = surfaceArea(leftBox);
+
+			rightSum += bins[BIN_COUNT - 1 - i].count;
+			grow(rightBox, bins[BIN_COUNT - 1 - i].bounds);
+			rightCount[BIN_COUNT - 2 - i] = rightSum;
+			rightArea[BIN_COUNT - 2 - i] = surfaceArea(rightBox);
+		}
+
+		for (int i = 0; i < BIN_COUNT - 1; ++i)
+		{
+			if (leftCount[i] == 0 || rightCount[i] == 0)
+			{
+				continue;
+			}
+
+			double cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = i;
+				bestMin = cmin;
+				bestScale = scale;
+			}
+		}
+	}
+
+	// Splitting has to beat testing every item in a single leaf
+	if (bestAxis < 0 || bestCost >= node.count * surfaceArea(node.bounds))
+	{
+		return;
+	}
+
+	uint32_t* begin = m_items.data() + node.first;
+	uint32_t* middle = std::partition(begin, begin + node.count, [&](uint32_t item)
+	{
+		int b = std::min(BIN_COUNT - 1, static_cast<int>((centroids[item * 3 + bestAxis] - bestMin) * bestScale));
+		return b <= bestSplit;
+	});
+
+	uint32_t leftCount = static_cast<uint32_t>(middle - begin);
+	uint32_t left = static_cast<uint32_t>(m_nodes.size());
+
+	m_nodes.push_back({ emptyBox(), 0, node.first, leftCount });
+	m_nodes.push_back({ emptyBox(), 0, node.first + leftCount, node.count - leftCount });
+	updateBounds(m_nodes[left]);
+	updateBounds(m_nodes[left + 1]);
+
+	m_nodes[nodeIndex].left = left;
+
+	subdivide(left, centroids);
+	subdivide(left + 1, centroids);
+}
+
+void BVH::update(uint32_t item, const AABB& box)
+{
+	m_boxes[item] = box;
+}
+
+void BVH::refit()
+{
+	auto start = Clock::now();
+
+	// Children always come after their parent, so walking backwards is bottom up
+	for (size_t i = m_nodes.size(); i-- > 0;)
+	{
+		Node& node = m_nodes[i];
+		if (node.isLeaf())
+		{
+			updateBounds(node);
+		}
+		else
+		{
+			node.bounds = m_nodes[node.left].bounds;
+			grow(node.bounds, m_nodes[node.left + 1].bounds);
+		}
+	}
+
+	m_stats.refitMs = elapsedMs(start);
+}
+
+void BVH::query(const Frustum& frustum, std::vector<uint32_t>& visible)
+{
+	auto start = Clock::now();
+
+	m_stats.visitedNodes = 0;
+	m_stats.acceptedNodes = 0;
+
+	if (m_nodes.empty())
+	{
+		m_stats.traverseMs = elapsedMs(start);
+		return;
+	}
+
+	m_stack.clear();
+	m_stack.push_back(0);
+
+	while (!m_stack.empty())
+	{
+		const Node& node = m_nodes[m_stack.back()];
+		m_stack.pop_back();
+		m_stats.visitedNodes++;
+
+		Frustum::Containment containment = frustum.classify(node.bounds);
+		if (containment == Frustum::Containment::OUTSIDE)
+		{
+			continue;
+		}
+
+		if (containment == Frustum::Containment::INSIDE)
+		{
+			// Everything below is visible, take the whole run without further tests
+			m_stats.acceptedNodes++;
+			visible.insert(visible.end(), m_items.begin() + node.first, m_items.begin() + node.first + node.count);
+			continue;
+		}
+
+		if (node.isLeaf())
+		{
+			for (uint32_t i = 0; i < node.count; ++i)
+			{
+				uint32_t item = m_items[node.first + i];
+				if (frustum.aabbIn(m_boxes[item]))
+				{
+					visible.push_back(item);
+				}
+			}
+			continue;
+		}
+
+		m_stack.push_back(node.left);
+		m_stack.push_back(node.left + 1);
+	}
+
+	m_stats.traverseMs = elapsedMs(start);
+}
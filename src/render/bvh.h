@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "../physics/aabb.h"
+
+class Frustum;
+
+// Static bounding volume hierarchy over scene boxes, built with binned SAH.
+// Every node covers a contiguous run of m_items, so a node that is entirely
+// inside the frustum hands over its whole run without visiting its children
+class BVH
+{
+public:
+	struct Stats
+	{
+		double buildMs = 0.0;
+		double refitMs = 0.0;
+		double traverseMs = 0.0;
+
+		size_t nodeCount = 0;
+		size_t visitedNodes = 0;
+		size_t acceptedNodes = 0;
+	};
+
+private:
+	struct Node
+	{
+		AABB bounds;
+
+		// Children are always stored next to each other, right is left + 1
+		uint32_t left;
+
+		// Range of m_items below this node
+		uint32_t first;
+		uint32_t count;
+
+		bool isLeaf() const { return left == 0; }
+	};
+
+	std::vector<Node> m_nodes;
+	std::vector<uint32_t> m_items;
+	std::vector<AABB> m_boxes;
+
+	// Traversal stack, kept around so queries don't allocate
+	std::vector<uint32_t> m_stack;
+
+	Stats m_stats;
+
+	void subdivide(uint32_t nodeIndex, std::vector<double>& centroids);
+
+	void updateBounds(Node& node) const;
+
+public:
+	static constexpr uint32_t MAX_LEAF_SIZE = 4;
+	static constexpr int BIN_COUNT = 12;
+
+	BVH() = default;
+
+	void build(const std::vector<AABB>& boxes);
+
+	// Move an item, the tree is only fixed up on the next refit
+	void update(uint32_t item, const AABB& box);
+
+	// Recomputes node bounds bottom up without changing the topology, fine while
+	// things only drift a little. Rebuild once the tree gets too loose
+	void refit();
+
+	// Appends the index of every box that is inside or touching the frustum
+	void query(const Frustum& frustum, std::vector<uint32_t>& visible);
+
+	const Stats& getStats() const
+	{
+		return m_stats;
+	}
+
+	size_t size() const
+	{
+		return m_boxes.size();
+	}
+};
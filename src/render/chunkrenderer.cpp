@@ -0,0 +1,429 @@
+#include "chunkrenderer.h"
+#include "frustum.h"
+#include "../graphics/shader.h"
+#include "../physics/aabb.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <iostream>
+
+void ChunkRenderer::RangeAllocator::grow(size_t capacity)
+{
+	if (capacity <= m_capacity)
+	{
+		return;
+	}
+
+	size_t added = capacity - m_capacity;
+	if (!m_free.empty() && m_free.back().offset + m_free.back().size == m_capacity)
+	{
+		m_free.back().size += added;
+	}
+	else
+	{
+		m_free.push_back({ m_capacity, added });
+	}
+
+	m_capacity = capacity;
+}
+
+size_t ChunkRenderer::RangeAllocator::allocate(size_t size)
+{
+	for (size_t i = 0; i < m_free.size(); ++i)
+	{
+		Range& range = m_free[i];
+		if (range.size < size)
+		{
+			continue;
+		}
+
+		size_t offset = range.offset;
+		range.offset += size;
+		range.size -= size;
+
+		if (range.size == 0)
+		{
+			m_free.erase(m_free.begin() + i);
+		}
+
+		m_used += size;
+		return offset;
+	}
+
+	return NO_SPACE;
+}
+
+void ChunkRenderer::RangeAllocator::release(size_t offset, size_t size)
+{
+	if (size == 0)
+	{
+		return;
+	}
+
+	m_used -= size;
+
+	auto next = std::lower_bound(m_free.begin(), m_free.end(), offset,
+		[](const Range& range, size_t value) { return range.offset < value; });
+
+	// Merge into the neighbours where they touch
+	bool joinsPrevious = next != m_free.begin() && (next - 1)->offset + (next - 1)->size == offset;
+	bool joinsNext = next != m_free.end() && offset + size == next->offset;
+
+	if (joinsPrevious && joinsNext)
+	{
+		(next - 1)->size += size + next->size;
+		m_free.erase(next);
+	}
+	else if (joinsPrevious)
+	{
+		(next - 1)->size += size;
+	}
+	else if (joinsNext)
+	{
+		next->offset = offset;
+		next->size += size;
+	}
+	else
+	{
+		m_free.insert(next, { offset, size });
+	}
+}
+
+ChunkRenderer::ChunkRenderer(size_t vertexCapacity, size_t indexCapacity)
+{
+	m_multiDraw = GLAD_GL_VERSION_4_6 != 0;
+
+	m_vertexSpace.grow(vertexCapacity);
+	m_indexSpace.grow(indexCapacity);
+
+	glGenVertexArrays(1, &m_vao);
+	glGenBuffers(1, &m_vbo);
+	glGenBuffers(1, &m_ibo);
+	glGenBuffers(1, &m_indirectBuffer);
+	glGenBuffers(1, &m_originBuffer);
+	glGenTextures(1, &m_originTexture);
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+	glBufferData(GL_ARRAY_BUFFER, vertexCapacity * sizeof(ChunkMesher::PackedVertex), nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCapacity * sizeof(unsigned int), nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	// The origin buffer has to exist before it can be attached to the texture
+	streamBuffer(m_originBuffer, GL_TEXTURE_BUFFER, m_originCapacity, 4 * sizeof(int32_t), nullptr);
+	glBindTexture(GL_TEXTURE_BUFFER, m_originTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32I, m_originBuffer);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+	setupAttributes();
+
+	// Reported once, it decides how every frame gets drawn
+	if (!m_multiDraw)
+	{
+		std::cout << "[WARNING] GL 4.6 not available, chunk sections are drawn one call at a time" << std::endl;
+	}
+}
+
+ChunkRenderer::~ChunkRenderer()
+{
+	glDeleteTextures(1, &m_originTexture);
+	glDeleteBuffers(1, &m_originBuffer);
+	glDeleteBuffers(1, &m_indirectBuffer);
+	glDeleteBuffers(1, &m_ibo);
+	glDeleteBuffers(1, &m_vbo);
+	glDeleteVertexArrays(1, &m_vao);
+}
+
+void ChunkRenderer::setupAttributes()
+{
+	glBindVertexArray(m_vao);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo);
+
+	glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, sizeof(ChunkMesher::PackedVertex), (void*)offsetof(ChunkMesher::PackedVertex, position));
+	glEnableVertexAttribArray(0);
+	glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, sizeof(ChunkMesher::PackedVertex), (void*)offsetof(ChunkMesher::PackedVertex, texture));
+	glEnableVertexAttribArray(1);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void ChunkRenderer::growBuffer(unsigned int& buffer, size_t oldBytes, size_t newBytes)
+{
+	unsigned int bigger;
+	glGenBuffers(1, &bigger);
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, bigger);
+	glBufferData(GL_COPY_WRITE_BUFFER, newBytes, nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	glDeleteBuffers(1, &buffer);
+	buffer = bigger;
+
+	// The vertex array still points at the old buffer
+	setupAttributes();
+}
+
+void ChunkRenderer::streamBuffer(unsigned int buffer, unsigned int target, size_t& capacity, size_t bytes, const void* data)
+{
+	glBindBuffer(target, buffer);
+
+	if (bytes > capacity)
+	{
+		capacity = std::max(bytes, capacity * 2);
+		glBufferData(target, capacity, nullptr, GL_STREAM_DRAW);
+	}
+	else
+	{
+		// Orphan the old storage so the driver doesn't stall on last frame's draws
+		glBufferData(target, capacity, nullptr, GL_STREAM_DRAW);
+	}
+
+	if (data && bytes > 0)
+	{
+		glBufferSubData(target, 0, bytes, data);
+	}
+
+	glBindBuffer(target, 0);
+}
+
+void ChunkRenderer::upload(const SectionPos& pos, const ChunkMesher::Mesh& mesh)
+{
+	remove(pos);
+
+	if (mesh.isEmpty())
+	{
+		return;
+	}
+
+	size_t vertexOffset = m_vertexSpace.allocate(mesh.vertices.size());
+	while (vertexOffset == RangeAllocator::NO_SPACE)
+	{
+		size_t capacity = m_vertexSpace.getCapacity();
+		size_t grown = std::max(capacity * 2, capacity + mesh.vertices.size());
+		growBuffer(m_vbo, capacity * sizeof(ChunkMesher::PackedVertex), grown * sizeof(ChunkMesher::PackedVertex));
+		m_vertexSpace.grow(grown);
+		vertexOffset = m_vertexSpace.allocate(mesh.vertices.size());
+	}
+
+	size_t indexOffset = m_indexSpace.allocate(mesh.indices.size());
+	while (indexOffset == RangeAllocator::NO_SPACE)
+	{
+		size_t capacity = m_indexSpace.getCapacity();
+		size_t grown = std::max(capacity * 2, capacity + mesh.indices.size());
+		growBuffer(m_ibo, capacity * sizeof(unsigned int), grown * sizeof(unsigned int));
+		m_indexSpace.grow(grown);
+		indexOffset = m_indexSpace.allocate(mesh.indices.size());
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+	glBufferSubData(GL_ARRAY_BUFFER, vertexOffset * sizeof(ChunkMesher::PackedVertex),
+		mesh.vertices.size() * sizeof(ChunkMesher::PackedVertex), mesh.vertices.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// The element buffer binding belongs to the vertex array, so go through a neutral target
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_ibo);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, indexOffset * sizeof(unsigned int),
+		mesh.indices.size() * sizeof(unsigned int), mesh.indices.data());
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	Section& section = m_sections[pos];
+	section.vertexOffset = vertexOffset;
+	section.vertexCount = mesh.vertices.size();
+	section.indexOffset = indexOffset;
+	section.indexCount = mesh.indices.size();
+	std::copy(mesh.passIndexCounts, mesh.passIndexCounts + RENDER_PASS_COUNT, section.passIndexCounts);
+
+	m_stats.sections = m_sections.size();
+}
+
+void ChunkRenderer::remove(const SectionPos& pos)
+{
+	auto it = m_sections.find(pos);
+	if (it == m_sections.end())
+	{
+		return;
+	}
+
+	m_vertexSpace.release(it->second.vertexOffset, it->second.vertexCount);
+	m_indexSpace.release(it->second.indexOffset, it->second.indexCount);
+	m_sections.erase(it);
+
+	m_stats.sections = m_sections.size();
+}
+
+void ChunkRenderer::prepare(const std::vector<SectionPos>& visible)
+{
+	m_commands.clear();
+	m_origins.clear();
+
+	m_stats.visibleSections = 0;
+
+	for (int pass = 0; pass < RENDER_PASS_COUNT; ++pass)
+	{
+		m_passFirst[pass] = m_commands.size();
+
+		for (size_t i = 0; i < visible.size(); ++i)
+		{
+			// Blending needs far to near, everything else near to far for early depth rejection
+			const SectionPos& pos = pass == RENDER_TRANSLUCENT ? visible[visible.size() - 1 - i] : visible[i];
+
+			auto it = m_sections.find(pos);
+			if (it == m_sections.end())
+			{
+				continue;
+			}
+
+			const Section& section = it->second;
+			if (pass == RENDER_OPAQUE)
+			{
+				++m_stats.visibleSections;
+			}
+
+			if (section.passIndexCounts[pass] == 0)
+			{
+				continue;
+			}
+
+			size_t first = section.indexOffset;
+			for (int earlier = 0; earlier < pass; ++earlier)
+			{
+				first += section.passIndexCounts[earlier];
+			}
+
+			m_commands.push_back({ static_cast<uint32_t>(section.passIndexCounts[pass]), 1, static_cast<uint32_t>(first), static_cast<int32_t>(section.vertexOffset), 0 });
+			m_origins.insert(m_origins.end(), { pos.x * ChunkSection::SIZE, pos.y * ChunkSection::SIZE, pos.z * ChunkSection::SIZE, 0 });
+		}
+
+		m_passCount[pass] = m_commands.size() - m_passFirst[pass];
+		m_stats.commands[pass] = m_passCount[pass];
+	}
+
+	streamBuffer(m_originBuffer, GL_TEXTURE_BUFFER, m_originCapacity, m_origins.size() * sizeof(int32_t), m_origins.data());
+
+	if (m_multiDraw)
+	{
+		streamBuffer(m_indirectBuffer, GL_DRAW_INDIRECT_BUFFER, m_indirectCapacity, m_commands.size() * sizeof(DrawCommand), m_commands.data());
+	}
+
+	m_stats.drawCalls = 0;
+	m_stats.vertexCapacity = m_vertexSpace.getCapacity();
+	m_stats.vertexUsed = m_vertexSpace.getUsed();
+	m_stats.indexCapacity = m_indexSpace.getCapacity();
+	m_stats.indexUsed = m_indexSpace.getUsed();
+}
+
+void ChunkRenderer::prepare(const Frustum& frustum, const Vec3<double>& camera)
+{
+	m_visible.clear();
+
+	for (const auto& entry : m_sections)
+	{
+		const SectionPos& pos = entry.first;
+		double size = ChunkSection::SIZE;
+
+		AABB bounds = { pos.x * size, pos.y * size, pos.z * size, (pos.x + 1) * size, (pos.y + 1) * size, (pos.z + 1) * size };
+		if (frustum.aabbIn(bounds))
+		{
+			m_visible.push_back(pos);
+		}
+	}
+
+	// The map is in no particular order, but the translucent pass relies on nearest first
+	auto distance = [&](const SectionPos& pos)
+	{
+		double half = ChunkSection::SIZE * 0.5;
+		double dx = pos.x * ChunkSection::SIZE + half - camera.x;
+		double dy = pos.y * ChunkSection::SIZE + half - camera.y;
+		double dz = pos.z * ChunkSection::SIZE + half - camera.z;
+		return dx * dx + dy * dy + dz * dz;
+	};
+
+	std::sort(m_visible.begin(), m_visible.end(), [&](const SectionPos& a, const SectionPos& b) { return distance(a) < distance(b); });
+
+	prepare(m_visible);
+}
+
+void ChunkRenderer::render(RenderPass pass, Shader& shader)
+{
+	if (m_passCount[pass] == 0)
+	{
+		return;
+	}
+
+	shader.bind();
+	shader.setInt("u_sectionOrigins", ORIGIN_TEXTURE_UNIT);
+	shader.setInt("u_drawBase", static_cast<int>(m_passFirst[pass]));
+
+	glActiveTexture(GL_TEXTURE0 + ORIGIN_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, m_originTexture);
+
+	glBindVertexArray(m_vao);
+
+	if (m_multiDraw)
+	{
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(m_passFirst[pass] * sizeof(DrawCommand)),
+			static_cast<GLsizei>(m_passCount[pass]), 0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		++m_stats.drawCalls;
+	}
+	else
+	{
+		for (size_t i = 0; i < m_passCount[pass]; ++i)
+		{
+			const DrawCommand& command = m_commands[m_passFirst[pass] + i];
+			shader.setInt("u_drawIndex", static_cast<int>(i));
+			glDrawElementsBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_INT,
+				(void*)(command.firstIndex * sizeof(unsigned int)), command.baseVertex);
+		}
+		m_stats.drawCalls += m_passCount[pass];
+	}
+
+	glBindVertexArray(0);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+std::string ChunkRenderer::getVertexShaderSource(bool multiDraw)
+{
+	std::string source = multiDraw ?
+		"#version 460 core\n#define DRAW_ID gl_DrawID\n" :
+		"#version 330 core\nuniform int u_drawIndex;\n#define DRAW_ID u_drawIndex\n";
+
+	source += R"(
+layout(location = 0) in uint a_position;
+layout(location = 1) in uint a_texture;
+
+uniform mat4 u_viewProj;
+uniform isamplerBuffer u_sectionOrigins;
+uniform int u_drawBase;
+
+out vec2 v_uv;
+flat out uint v_layer;
+flat out uint v_face;
+out float v_ao;
+out vec2 v_light;
+
+void main()
+{
+	ivec3 origin = texelFetch(u_sectionOrigins, u_drawBase + DRAW_ID).xyz;
+	vec3 local = vec3(a_position & 31u, (a_position >> 5) & 31u, (a_position >> 10) & 31u);
+
+	v_face = (a_position >> 15) & 7u;
+	v_ao = float((a_position >> 18) & 3u) / 3.0;
+	v_light = vec2((a_position >> 20) & 15u, (a_position >> 24) & 15u) / 15.0;
+	v_layer = a_texture & 0xFFFFu;
+	v_uv = vec2((a_texture >> 16) & 255u, (a_texture >> 24) & 255u);
+
+	gl_Position = u_viewProj * vec4(vec3(origin) + local, 1.0);
+}
+)";
+
+	return source;
+}
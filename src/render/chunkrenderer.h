@@ -0,0 +1,159 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include "../world/chunkmesher.h"
+#include "../world/sectionpos.h"
+#include "../utility/vec.h"
+
+class Frustum;
+class Shader;
+
+// Draws every chunk section out of one shared vertex buffer and one shared index buffer.
+// Each frame the visible sections become one indirect draw command per section and pass,
+// and a pass is drawn with a single glMultiDrawElementsIndirect. Contexts older than 4.6
+// issue the same commands one by one. Shaders find the section origin through the draw
+// index, see getVertexShaderSource
+class ChunkRenderer
+{
+public:
+	// Texture unit the section origin buffer is bound to while drawing
+	static constexpr unsigned int ORIGIN_TEXTURE_UNIT = 15;
+
+	struct Stats
+	{
+		size_t sections = 0;
+		size_t visibleSections = 0;
+		size_t commands[RENDER_PASS_COUNT] = {};
+		size_t drawCalls = 0;
+
+		// In vertices and indices
+		size_t vertexCapacity = 0;
+		size_t vertexUsed = 0;
+		size_t indexCapacity = 0;
+		size_t indexUsed = 0;
+	};
+
+private:
+	// Laid out the way glMultiDrawElementsIndirect reads it
+	struct DrawCommand
+	{
+		uint32_t count;
+		uint32_t instanceCount;
+		uint32_t firstIndex;
+		int32_t baseVertex;
+		uint32_t baseInstance;
+	};
+
+	// First fit allocator over element ranges of a shared buffer
+	class RangeAllocator
+	{
+	public:
+		static constexpr size_t NO_SPACE = SIZE_MAX;
+
+	private:
+		struct Range
+		{
+			size_t offset;
+			size_t size;
+		};
+
+		// Sorted by offset, neighbours always merged
+		std::vector<Range> m_free;
+
+		size_t m_capacity = 0;
+		size_t m_used = 0;
+
+	public:
+		void grow(size_t capacity);
+
+		size_t allocate(size_t size);
+
+		void release(size_t offset, size_t size);
+
+		size_t getCapacity() const { return m_capacity; }
+
+		size_t getUsed() const { return m_used; }
+	};
+
+	struct Section
+	{
+		size_t vertexOffset;
+		size_t vertexCount;
+		size_t indexOffset;
+		size_t indexCount;
+		size_t passIndexCounts[RENDER_PASS_COUNT];
+	};
+
+	std::unordered_map<SectionPos, Section> m_sections;
+
+	RangeAllocator m_vertexSpace;
+	RangeAllocator m_indexSpace;
+
+	unsigned int m_vao = 0;
+	unsigned int m_vbo = 0;
+	unsigned int m_ibo = 0;
+	unsigned int m_indirectBuffer = 0;
+	unsigned int m_originBuffer = 0;
+	unsigned int m_originTexture = 0;
+
+	size_t m_indirectCapacity = 0;
+	size_t m_originCapacity = 0;
+
+	// Every pass back to back, m_passFirst says where each starts
+	std::vector<DrawCommand> m_commands;
+	std::vector<int32_t> m_origins;
+	size_t m_passFirst[RENDER_PASS_COUNT] = {};
+	size_t m_passCount[RENDER_PASS_COUNT] = {};
+
+	std::vector<SectionPos> m_visible;
+
+	bool m_multiDraw = false;
+
+	Stats m_stats;
+
+	// Moves a buffer's contents into a bigger one
+	void growBuffer(unsigned int& buffer, size_t oldBytes, size_t newBytes);
+
+	void setupAttributes();
+
+	// Replaces a per-frame buffer's contents, reallocating only when it has to grow
+	void streamBuffer(unsigned int buffer, unsigned int target, size_t& capacity, size_t bytes, const void* data);
+
+public:
+	// Starting sizes in vertices and indices, both double when they run out
+	ChunkRenderer(size_t vertexCapacity = 1 << 20, size_t indexCapacity = 3 << 19);
+
+	~ChunkRenderer();
+
+	ChunkRenderer(const ChunkRenderer& other) = delete;
+
+	ChunkRenderer& operator=(const ChunkRenderer& other) = delete;
+
+	// Replaces a section's mesh, an empty mesh removes it. Fits MeshingPipeline::UploadCallback
+	void upload(const SectionPos& pos, const ChunkMesher::Mesh& mesh);
+
+	void remove(const SectionPos& pos);
+
+	bool hasSection(const SectionPos& pos) const { return m_sections.count(pos) != 0; }
+
+	// Builds this frame's draw commands from an already culled list, nearest first
+	void prepare(const std::vector<SectionPos>& visible);
+
+	// Frustum culls every section itself and sorts the survivors by distance to camera
+	void prepare(const Frustum& frustum, const Vec3<double>& camera);
+
+	// Draws one pass of the prepared sections. Translucent sections go far to near
+	void render(RenderPass pass, Shader& shader);
+
+	bool isMultiDrawSupported() const { return m_multiDraw; }
+
+	const Stats& getStats() const { return m_stats; }
+
+	// Vertex shader that unpacks ChunkMesher::PackedVertex. Outputs v_uv, v_layer, v_face,
+	// v_ao and v_light (sky, block) for the fragment shader, and takes u_viewProj
+	static std::string getVertexShaderSource(bool multiDraw);
+};
@@ -1,4 +1,13 @@
 #include "frustum.h"
+#include <algorithm>
+
+#if defined(__AVX2__)
+#define FRUSTUM_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_SSE2
+#include <emmintrin.h>
+#endif
 
 constexpr int PLANE_COUNT = 6;
 constexpr int PLANE_COMBINATIONS = PLANE_COUNT * (PLANE_COUNT - 1) / 2;
@@ -7,30 +16,30 @@ Frustum::Frustum(const Camera3D& camera)
 {
 	auto m = glm::transpose(camera.getProjection() * camera.getView());
 
-	m_planes[Planes::LEFT] =	m[3] + m[0];
-	m_planes[Planes::RIGHT] =	m[3] - m[0];
-	m_planes[Planes::BOTTOM] =	m[3] + m[1];
-	m_planes[Planes::TOP] =		m[3] - m[1];
-	m_planes[Planes::NEAR] =	m[3] + m[2];
-	m_planes[Planes::FAR] =		m[3] - m[2];
+	plane(Planes::LEFT) =	m[3] + m[0];
+	plane(Planes::RIGHT) =	m[3] - m[0];
+	plane(Planes::BOTTOM) =	m[3] + m[1];
+	plane(Planes::TOP) =		m[3] - m[1];
+	plane(Planes::NEAR) =	m[3] + m[2];
+	plane(Planes::FAR) =		m[3] - m[2];
 
 	glm::vec3 crosses[PLANE_COMBINATIONS] =
 	{
-		glm::cross(glm::vec3(m_planes[Planes::LEFT]),   glm::vec3(m_planes[Planes::RIGHT])),
-		glm::cross(glm::vec3(m_planes[Planes::LEFT]),   glm::vec3(m_planes[Planes::BOTTOM])),
-		glm::cross(glm::vec3(m_planes[Planes::LEFT]),   glm::vec3(m_planes[Planes::TOP])),
-		glm::cross(glm::vec3(m_planes[Planes::LEFT]),   glm::vec3(m_planes[Planes::NEAR])),
-		glm::cross(glm::vec3(m_planes[Planes::LEFT]),   glm::vec3(m_planes[Planes::FAR])),
-		glm::cross(glm::vec3(m_planes[Planes::RIGHT]),  glm::vec3(m_planes[Planes::BOTTOM])),
-		glm::cross(glm::vec3(m_planes[Planes::RIGHT]),  glm::vec3(m_planes[Planes::TOP])),
-		glm::cross(glm::vec3(m_planes[Planes::RIGHT]),  glm::vec3(m_planes[Planes::NEAR])),
-		glm::cross(glm::vec3(m_planes[Planes::RIGHT]),  glm::vec3(m_planes[Planes::FAR])),
-		glm::cross(glm::vec3(m_planes[Planes::BOTTOM]), glm::vec3(m_planes[Planes::TOP])),
-		glm::cross(glm::vec3(m_planes[Planes::BOTTOM]), glm::vec3(m_planes[Planes::NEAR])),
-		glm::cross(glm::vec3(m_planes[Planes::BOTTOM]), glm::vec3(m_planes[Planes::FAR])),
-		glm::cross(glm::vec3(m_planes[Planes::TOP]),    glm::vec3(m_planes[Planes::NEAR])),
-		glm::cross(glm::vec3(m_planes[Planes::TOP]),    glm::vec3(m_planes[Planes::FAR])),
-		glm::cross(glm::vec3(m_planes[Planes::NEAR]),   glm::vec3(m_planes[Planes::FAR]))
+		glm::cross(glm::vec3(plane(Planes::LEFT)),   glm::vec3(plane(Planes::RIGHT))),
+		glm::cross(glm::vec3(plane(Planes::LEFT)),   glm::vec3(plane(Planes::BOTTOM))),
+		glm::cross(glm::vec3(plane(Planes::LEFT)),   glm::vec3(plane(Planes::TOP))),
+		glm::cross(glm::vec3(plane(Planes::LEFT)),   glm::vec3(plane(Planes::NEAR))),
+		glm::cross(glm::vec3(plane(Planes::LEFT)),   glm::vec3(plane(Planes::FAR))),
+		glm::cross(glm::vec3(plane(Planes::RIGHT)),  glm::vec3(plane(Planes::BOTTOM))),
+		glm::cross(glm::vec3(plane(Planes::RIGHT)),  glm::vec3(plane(Planes::TOP))),
+		glm::cross(glm::vec3(plane(Planes::RIGHT)),  glm::vec3(plane(Planes::NEAR))),
+		glm::cross(glm::vec3(plane(Planes::RIGHT)),  glm::vec3(plane(Planes::FAR))),
+		glm::cross(glm::vec3(plane(Planes::BOTTOM)), glm::vec3(plane(Planes::TOP))),
+		glm::cross(glm::vec3(plane(Planes::BOTTOM)), glm::vec3(plane(Planes::NEAR))),
+		glm::cross(glm::vec3(plane(Planes::BOTTOM)), glm::vec3(plane(Planes::FAR))),
+		glm::cross(glm::vec3(plane(Planes::TOP)),    glm::vec3(plane(Planes::NEAR))),
+		glm::cross(glm::vec3(plane(Planes::TOP)),    glm::vec3(plane(Planes::FAR))),
+		glm::cross(glm::vec3(plane(Planes::NEAR)),   glm::vec3(plane(Planes::FAR)))
 	};
 
 	m_points[0] = intersection<Planes::LEFT, Planes::BOTTOM, Planes::NEAR>(crosses);
@@ -42,6 +51,13 @@ Frustum::Frustum(const Camera3D& camera)
 	m_points[6] = intersection<Planes::RIGHT, Planes::BOTTOM, Planes::FAR>(crosses);
 	m_points[7] = intersection<Planes::RIGHT, Planes::TOP, Planes::FAR>(crosses);
 
+	m_pointsMin = m_points[0];
+	m_pointsMax = m_points[0];
+	for (int i = 1; i < 8; i++)
+	{
+		m_pointsMin = glm::min(m_pointsMin, m_points[i]);
+		m_pointsMax = glm::max(m_pointsMax, m_points[i]);
+	}
 }
 
 // http://iquilezles.org/www/articles/frustumcorrect/frustumcorrect.htm
@@ -50,14 +66,14 @@ bool Frustum::aabbIn(const AABB& aabb) const
 	// check box outside/inside of frustum
 	for (int i = 0; i < PLANE_COUNT; i++)
 	{
-		if ((glm::dot(m_planes.at(static_cast<Planes>(i)), glm::vec4(aabb.minX, aabb.minY, aabb.minZ, 1.0f)) < 0.0) &&
-			(glm::dot(m_planes.at(static_cast<Planes>(i)), glm::vec4(aabb.maxX, aabb.minY, aabb.minZ, 1.0f)) < 0.0) &&
-			(glm::dot(m_planes.at(static_cast<Planes>(i)), glm::vec4(aabb.minX, aabb.maxY, aabb.minZ, 1.0f)) < 0.0) &&
-			(glm::dot(m_planes.at(static_cast<Planes>(i)), glm::vec4(aabb.maxX, aabb.maxY, aabb.minZ, 1.0f)) < 0.0) &&
-			(glm::dot(m_planes.at(static_cast<Planes>(i)), glm::vec4(aabb.minX, aabb.minY, aabb.maxZ, 1.0f)) < 0.0) &&
-			(glm::dot(m_planes.at(static_cast<Planes>(i)), glm::vec4(aabb.maxX, aabb.minY, aabb.maxZ, 1.0f)) < 0.0) &&
-			(glm::dot(m_planes.at(static_cast<Planes>(i)), glm::vec4(aabb.minX, aabb.maxY, aabb.maxZ, 1.0f)) < 0.0) &&
-			(glm::dot(m_planes.at(static_cast<Planes>(i)), glm::vec4(aabb.maxX, aabb.maxY, aabb.maxZ, 1.0f)) < 0.0))
+		if ((glm::dot(m_planes[i], glm::vec4(aabb.minX, aabb.minY, aabb.minZ, 1.0f)) < 0.0) &&
+			(glm::dot(m_planes[i], glm::vec4(aabb.maxX, aabb.minY, aabb.minZ, 1.0f)) < 0.0) &&
+			(glm::dot(m_planes[i], glm::vec4(aabb.minX, aabb.maxY, aabb.minZ, 1.0f)) < 0.0) &&
+			(glm::dot(m_planes[i], glm::vec4(aabb.maxX, aabb.maxY, aabb.minZ, 1.0f)) < 0.0) &&
+			(glm::dot(m_planes[i], glm::vec4(aabb.minX, aabb.minY, aabb.maxZ, 1.0f)) < 0.0) &&
+			(glm::dot(m_planes[i], glm::vec4(aabb.maxX, aabb.minY, aabb.maxZ, 1.0f)) < 0.0) &&
+			(glm::dot(m_planes[i], glm::vec4(aabb.minX, aabb.maxY, aabb.maxZ, 1.0f)) < 0.0) &&
+			(glm::dot(m_planes[i], glm::vec4(aabb.maxX, aabb.maxY, aabb.maxZ, 1.0f)) < 0.0))
 		{
 			return false;
 		}
@@ -73,4 +89,155 @@ bool Frustum::aabbIn(const AABB& aabb) const
 	out = 0; for (int i = 0; i < 8; i++) out += ((m_points[i].z < aabb.minZ) ? 1 : 0); if (out == 8) return false;
 
 	return true;
+}
+
+Frustum::Containment Frustum::classify(const AABB& aabb) const
+{
+	Containment result = Containment::INSIDE;
+
+	for (int i = 0; i < PLANE_COUNT; i++)
+	{
+		const glm::vec4& n = m_planes[i];
+
+		// p-vertex is the corner furthest along the normal, n-vertex the nearest
+		glm::vec4 p(n.x > 0.0f ? aabb.maxX : aabb.minX, n.y > 0.0f ? aabb.maxY : aabb.minY, n.z > 0.0f ? aabb.maxZ : aabb.minZ, 1.0f);
+		glm::vec4 q(n.x > 0.0f ? aabb.minX : aabb.maxX, n.y > 0.0f ? aabb.minY : aabb.maxY, n.z > 0.0f ? aabb.minZ : aabb.maxZ, 1.0f);
+
+		if (glm::dot(n, p) < 0.0f)
+		{
+			return Containment::OUTSIDE;
+		}
+		if (glm::dot(n, q) < 0.0f)
+		{
+			result = Containment::INTERSECTS;
+		}
+	}
+
+	if (m_pointsMin.x > aabb.maxX || m_pointsMax.x < aabb.minX ||
+		m_pointsMin.y > aabb.maxY || m_pointsMax.y < aabb.minY ||
+		m_pointsMin.z > aabb.maxZ || m_pointsMax.z < aabb.minZ)
+	{
+		return Containment::OUTSIDE;
+	}
+
+	return result;
+}
+
+void Frustum::cullScalar(const CullBounds& bounds, uint32_t* visibility) const
+{
+	std::fill(visibility, visibility + (bounds.count + 31) / 32, 0u);
+	cullRange(bounds, 0, visibility);
+}
+
+// Scalar version of the batched test, used for the tail of the SIMD paths.
+// Only the p-vertex (the corner furthest along the plane normal) needs testing
+// per plane, if it's behind the plane then all eight corners are
+void Frustum::cullRange(const CullBounds& bounds, size_t first, uint32_t* visibility) const
+{
+	for (size_t i = first; i < bounds.count; i++)
+	{
+		bool visible = true;
+
+		for (int p = 0; p < PLANE_COUNT && visible; p++)
+		{
+			const glm::vec4& n = m_planes[p];
+			float x = n.x > 0.0f ? bounds.maxX[i] : bounds.minX[i];
+			float y = n.y > 0.0f ? bounds.maxY[i] : bounds.minY[i];
+			float z = n.z > 0.0f ? bounds.maxZ[i] : bounds.minZ[i];
+			visible = ((n.x * x + n.y * y) + (n.z * z + n.w)) >= 0.0f;
+		}
+
+		visible = visible &&
+			!(m_pointsMin.x > bounds.maxX[i]) && !(m_pointsMax.x < bounds.minX[i]) &&
+			!(m_pointsMin.y > bounds.maxY[i]) && !(m_pointsMax.y < bounds.minY[i]) &&
+			!(m_pointsMin.z > bounds.maxZ[i]) && !(m_pointsMax.z < bounds.minZ[i]);
+
+		if (visible)
+		{
+			visibility[i / 32] |= 1u << (i % 32);
+		}
+	}
+}
+
+void Frustum::cull(const CullBounds& bounds, uint32_t* visibility) const
+{
+	std::fill(visibility, visibility + (bounds.count + 31) / 32, 0u);
+
+	size_t i = 0;
+
+#if defined(FRUSTUM_AVX2)
+	// 8 boxes per iteration, 4 iterations fill one visibility word
+	for (; i + 8 <= bounds.count; i += 8)
+	{
+		__m256 minX = _mm256_loadu_ps(bounds.minX + i), maxX = _mm256_loadu_ps(bounds.maxX + i);
+		__m256 minY = _mm256_loadu_ps(bounds.minY + i), maxY = _mm256_loadu_ps(bounds.maxY + i);
+		__m256 minZ = _mm256_loadu_ps(bounds.minZ + i), maxZ = _mm256_loadu_ps(bounds.maxZ + i);
+
+		__m256 outside = _mm256_setzero_ps();
+
+		for (int p = 0; p < PLANE_COUNT; p++)
+		{
+			const glm::vec4& n = m_planes[p];
+
+			// The normal's sign is the same for every box, so the p-vertex is picked per plane
+			__m256 x = n.x > 0.0f ? maxX : minX;
+			__m256 y = n.y > 0.0f ? maxY : minY;
+			__m256 z = n.z > 0.0f ? maxZ : minZ;
+
+			__m256 d = _mm256_add_ps(
+				_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(n.x), x), _mm256_mul_ps(_mm256_set1_ps(n.y), y)),
+				_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(n.z), z), _mm256_set1_ps(n.w)));
+
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_LT_OQ));
+		}
+
+		outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_set1_ps(m_pointsMin.x), maxX, _CMP_GT_OQ));
+		outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_set1_ps(m_pointsMax.x), minX, _CMP_LT_OQ));
+		outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_set1_ps(m_pointsMin.y), maxY, _CMP_GT_OQ));
+		outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_set1_ps(m_pointsMax.y), minY, _CMP_LT_OQ));
+		outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_set1_ps(m_pointsMin.z), maxZ, _CMP_GT_OQ));
+		outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_set1_ps(m_pointsMax.z), minZ, _CMP_LT_OQ));
+
+		uint32_t visible = ~static_cast<uint32_t>(_mm256_movemask_ps(outside)) & 0xFFu;
+		visibility[i / 32] |= visible << (i % 32);
+	}
+#elif defined(FRUSTUM_SSE2)
+	// 4 boxes per iteration, 8 iterations fill one visibility word
+	for (; i + 4 <= bounds.count; i += 4)
+	{
+		__m128 minX = _mm_loadu_ps(bounds.minX + i), maxX = _mm_loadu_ps(bounds.maxX + i);
+		__m128 minY = _mm_loadu_ps(bounds.minY + i), maxY = _mm_loadu_ps(bounds.maxY + i);
+		__m128 minZ = _mm_loadu_ps(bounds.minZ + i), maxZ = _mm_loadu_ps(bounds.maxZ + i);
+
+		__m128 outside = _mm_setzero_ps();
+
+		for (int p = 0; p < PLANE_COUNT; p++)
+		{
+			const glm::vec4& n = m_planes[p];
+
+			// The normal's sign is the same for every box, so the p-vertex is picked per plane
+			__m128 x = n.x > 0.0f ? maxX : minX;
+			__m128 y = n.y > 0.0f ? maxY : minY;
+			__m128 z = n.z > 0.0f ? maxZ : minZ;
+
+			__m128 d = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(_mm_set1_ps(n.x), x), _mm_mul_ps(_mm_set1_ps(n.y), y)),
+				_mm_add_ps(_mm_mul_ps(_mm_set1_ps(n.z), z), _mm_set1_ps(n.w)));
+
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(d, _mm_setzero_ps()));
+		}
+
+		outside = _mm_or_ps(outside, _mm_cmpgt_ps(_mm_set1_ps(m_pointsMin.x), maxX));
+		outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_set1_ps(m_pointsMax.x), minX));
+		outside = _mm_or_ps(outside, _mm_cmpgt_ps(_mm_set1_ps(m_pointsMin.y), maxY));
+		outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_set1_ps(m_pointsMax.y), minY));
+		outside = _mm_or_ps(outside, _mm_cmpgt_ps(_mm_set1_ps(m_pointsMin.z), maxZ));
+		outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_set1_ps(m_pointsMax.z), minZ));
+
+		uint32_t visible = ~static_cast<uint32_t>(_mm_movemask_ps(outside)) & 0xFu;
+		visibility[i / 32] |= visible << (i % 32);
+	}
+#endif
+
+	cullRange(bounds, i, visibility);
 }
\ No newline at end of file
@@ -5,16 +5,46 @@
 #include <matrix.hpp>
 #include "../physics/aabb.h"
 #include "camera3d.h"
-#include <map>
+#include <cstddef>
+#include <cstdint>
+
+// Structure of arrays box bounds for batched culling, each array holds count floats
+struct CullBounds
+{
+	const float* minX;
+	const float* minY;
+	const float* minZ;
+	const float* maxX;
+	const float* maxY;
+	const float* maxZ;
+	size_t count;
+};
 
 class Frustum
 {
 public:
+	enum class Containment
+	{
+		OUTSIDE = 0,
+		INTERSECTS,
+		INSIDE
+	};
+
 	Frustum(const Camera3D& camera);
 
 	// http://iquilezles.org/www/articles/frustumcorrect/frustumcorrect.htm
 	bool aabbIn(const AABB& aabb) const;
 
+	// Like aabbIn but also tells apart boxes that are entirely inside every plane
+	Containment classify(const AABB& aabb) const;
+
+	// Same test as aabbIn over many boxes at once. Bit i of visibility (32 boxes per word)
+	// is set when box i is visible, visibility needs room for (count + 31) / 32 words
+	void cull(const CullBounds& bounds, uint32_t* visibility) const;
+
+	// Reference path for cull, one box at a time
+	void cullScalar(const CullBounds& bounds, uint32_t* visibility) const;
+
 private:
 	enum class Planes
 	{
@@ -26,9 +56,25 @@ private:
 		FAR
 	};
 
-	std::map<Planes, glm::vec4> m_planes;
+	glm::vec4 m_planes[6];
 	glm::vec3 m_points[8];
 
+	// Bounds of m_points, a box past any side of these has every corner outside
+	glm::vec3 m_pointsMin;
+	glm::vec3 m_pointsMax;
+
+	glm::vec4& plane(Planes p)
+	{
+		return m_planes[static_cast<int>(p)];
+	}
+
+	const glm::vec4& plane(Planes p) const
+	{
+		return m_planes[static_cast<int>(p)];
+	}
+
+	void cullRange(const CullBounds& bounds, size_t first, uint32_t* visibility) const;
+
 	// i * (9 - i) / 2 + j - 1
 	template<Planes i, Planes j>
 	static size_t ij2k()
@@ -39,10 +85,10 @@ private:
 	template<Planes a, Planes b, Planes c>
 	glm::vec3 intersection(const glm::vec3* crosses) const
 	{
-		float dot = glm::dot(glm::vec3(m_planes.at(a)), crosses[ij2k<b, c>()]);
+		float dot = glm::dot(glm::vec3(plane(a)), crosses[ij2k<b, c>()]);
 
 		glm::vec3 res = glm::mat3(crosses[ij2k<b, c>()], -crosses[ij2k<a, c>()], crosses[ij2k<a, b>()]) *
-			glm::vec3(m_planes.at(a).w, m_planes.at(b).w, m_planes.at(c).w);
+			glm::vec3(plane(a).w, plane(b).w, plane(c).w);
 
 		return res * (-1.0f / dot);
 	}
@@ -0,0 +1,342 @@
+#include "occlusionculler.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_SSE2
+#include <emmintrin.h>
+#endif
+
+constexpr float FAR_DEPTH = 1.0f;
+
+// Only guards the perspective divide, clipping itself is done at the GL near plane z = -w
+constexpr float NEAR_W = 1e-3f;
+
+OcclusionCuller::OcclusionCuller(int width, int height) :
+	m_width(width),
+	m_height(height),
+	m_pitch((width + 3) & ~3)
+{
+	int w = m_pitch, h = m_height;
+	m_levels.emplace_back(static_cast<size_t>(w) * h, FAR_DEPTH);
+	m_levelSizes.emplace_back(w, h);
+
+	while (w > 1 || h > 1)
+	{
+		w = std::max(1, (w + 1) / 2);
+		h = std::max(1, (h + 1) / 2);
+		m_levels.emplace_back(static_cast<size_t>(w) * h, FAR_DEPTH);
+		m_levelSizes.emplace_back(w, h);
+	}
+}
+
+void OcclusionCuller::beginFrame(const glm::mat4& viewProjection)
+{
+	m_viewProjection = viewProjection;
+	std::fill(m_levels[0].begin(), m_levels[0].end(), FAR_DEPTH);
+	m_stats = Stats();
+}
+
+glm::vec4 OcclusionCuller::toScreen(const glm::vec4& clip) const
+{
+	float invW = 1.0f / clip.w;
+	return glm::vec4(
+		(clip.x * invW * 0.5f + 0.5f) * m_width,
+		(clip.y * invW * 0.5f + 0.5f) * m_height,
+		clip.z * invW * 0.5f + 0.5f,
+		clip.w
+	);
+}
+
+void OcclusionCuller::clipTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+{
+	const glm::vec4 in[3] = { a, b, c };
+	glm::vec4 out[4];
+	int count = 0;
+
+	// Sutherland-Hodgman against the near plane only, the rest is clamped by the bounding rect.
+	// This has to be the same plane the GPU clips at, anything in front of it is never drawn and
+	// mustn't hide what's behind it
+	for (int i = 0; i < 3; ++i)
+	{
+		const glm::vec4& p = in[i];
+		const glm::vec4& q = in[(i + 1) % 3];
+		float pDist = p.z + p.w, qDist = q.z + q.w;
+		bool pIn = pDist >= 0.0f, qIn = qDist >= 0.0f;
+
+		if (pIn)
+		{
+			out[count++] = p;
+		}
+		if (pIn != qIn)
+		{
+			float t = pDist / (pDist - qDist);
+			out[count++] = p + (q - p) * t;
+		}
+	}
+
+	if (count < 3)
+	{
+		return;
+	}
+
+	for (int i = 0; i < count; ++i)
+	{
+		if (out[i].w < NEAR_W)
+		{
+			return;
+		}
+	}
+
+	glm::vec4 s0 = toScreen(out[0]);
+	for (int i = 1; i + 1 < count; ++i)
+	{
+		rasterizeTriangle(s0, toScreen(out[i]), toScreen(out[i + 1]));
+	}
+}
+
+void OcclusionCuller::rasterizeTriangle(glm::vec4 a, glm::vec4 b, glm::vec4 c)
+{
+	auto edge = [](const glm::vec4& p, const glm::vec4& q, float x, float y)
+	{
+		return (x - p.x) * (q.y - p.y) - (y - p.y) * (q.x - p.x);
+	};
+
+	float area = edge(a, b, c.x, c.y);
+	if (std::fabs(area) < 1e-6f)
+	{
+		return;
+	}
+
+	// Occluders are drawn from both sides, so flip to one winding
+	if (area < 0.0f)
+	{
+		std::swap(b, c);
+		area = -area;
+	}
+
+	int minX = std::max(0, static_cast<int>(std::floor(std::min({ a.x, b.x, c.x }))));
+	int maxX = std::min(m_width - 1, static_cast<int>(std::ceil(std::max({ a.x, b.x, c.x }))));
+	int minY = std::max(0, static_cast<int>(std::floor(std::min({ a.y, b.y, c.y }))));
+	int maxY = std::min(m_height - 1, static_cast<int>(std::ceil(std::max({ a.y, b.y, c.y }))));
+
+	if (minX > maxX || minY > maxY)
+	{
+		return;
+	}
+
+	m_stats.occluderTriangles++;
+
+	// Start on a 4 pixel boundary, rows are padded so the last group never runs over
+	minX &= ~3;
+
+	// Edge functions and depth are linear in screen space, so they just step along
+	float invArea = 1.0f / area;
+	float e0dx = (c.y - b.y), e0dy = -(c.x - b.x);
+	float e1dx = (a.y - c.y), e1dy = -(a.x - c.x);
+	float e2dx = (b.y - a.y), e2dy = -(b.x - a.x);
+	float zdx = (e0dx * a.z + e1dx * b.z + e2dx * c.z) * invArea;
+	float zdy = (e0dy * a.z + e1dy * b.z + e2dy * c.z) * invArea;
+
+	float px = minX + 0.5f, py = minY + 0.5f;
+	float e0Row = edge(b, c, px, py);
+	float e1Row = edge(c, a, px, py);
+	float e2Row = edge(a, b, px, py);
+	float zRow = (e0Row * a.z + e1Row * b.z + e2Row * c.z) * invArea;
+
+	std::vector<float>& depth = m_levels[0];
+
+	for (int y = minY; y <= maxY; ++y)
+	{
+		float* row = depth.data() + y * m_pitch;
+		int x = minX;
+
+#ifdef OCCLUSION_SSE2
+		const __m128 offsets = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+		const __m128 zero = _mm_setzero_ps();
+
+		__m128 e0 = _mm_add_ps(_mm_set1_ps(e0Row), _mm_mul_ps(offsets, _mm_set1_ps(e0dx)));
+		__m128 e1 = _mm_add_ps(_mm_set1_ps(e1Row), _mm_mul_ps(offsets, _mm_set1_ps(e1dx)));
+		__m128 e2 = _mm_add_ps(_mm_set1_ps(e2Row), _mm_mul_ps(offsets, _mm_set1_ps(e2dx)));
+		__m128 z = _mm_add_ps(_mm_set1_ps(zRow), _mm_mul_ps(offsets, _mm_set1_ps(zdx)));
+
+		const __m128 e0Step = _mm_set1_ps(e0dx * 4.0f);
+		const __m128 e1Step = _mm_set1_ps(e1dx * 4.0f);
+		const __m128 e2Step = _mm_set1_ps(e2dx * 4.0f);
+		const __m128 zStep = _mm_set1_ps(zdx * 4.0f);
+
+		for (; x <= maxX; x += 4)
+		{
+			__m128 inside = _mm_and_ps(
+				_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)),
+				_mm_cmpge_ps(e2, zero));
+
+			if (_mm_movemask_ps(inside) != 0)
+			{
+				__m128 old = _mm_loadu_ps(row + x);
+				__m128 nearest = _mm_min_ps(old, z);
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, old)));
+			}
+
+			e0 = _mm_add_ps(e0, e0Step);
+			e1 = _mm_add_ps(e1, e1Step);
+			e2 = _mm_add_ps(e2, e2Step);
+			z = _mm_add_ps(z, zStep);
+		}
+#else
+		float e0 = e0Row, e1 = e1Row, e2 = e2Row, z = zRow;
+		for (; x <= maxX; ++x)
+		{
+			if (e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f)
+			{
+				row[x] = std::min(row[x], z);
+			}
+
+			e0 += e0dx;
+			e1 += e1dx;
+			e2 += e2dx;
+			z += zdx;
+		}
+#endif
+
+		e0Row += e0dy;
+		e1Row += e1dy;
+		e2Row += e2dy;
+		zRow += zdy;
+	}
+}
+
+void OcclusionCuller::addOccluder(const AABB& box)
+{
+	glm::vec4 corners[8];
+	for (int i = 0; i < 8; ++i)
+	{
+		glm::vec4 p(
+			static_cast<float>((i & 1) ? box.maxX : box.minX),
+			static_cast<float>((i & 2) ? box.maxY : box.minY),
+			static_cast<float>((i & 4) ? box.maxZ : box.minZ),
+			1.0f
+		);
+		corners[i] = m_viewProjection * p;
+	}
+
+	// Two triangles for each of the six faces
+	static const int faces[6][4] =
+	{
+		{ 0, 2, 6, 4 }, { 1, 5, 7, 3 },
+		{ 0, 4, 5, 1 }, { 2, 3, 7, 6 },
+		{ 0, 1, 3, 2 }, { 4, 6, 7, 5 }
+	};
+
+	for (const auto& f : faces)
+	{
+		clipTriangle(corners[f[0]], corners[f[1]], corners[f[2]]);
+		clipTriangle(corners[f[0]], corners[f[2]], corners[f[3]]);
+	}
+}
+
+void OcclusionCuller::addOccluder(const float* positions, size_t stride, const unsigned int* indices, size_t indexCount)
+{
+	auto vertex = [&](unsigned int index)
+	{
+		const float* p = reinterpret_cast<const float*>(reinterpret_cast<const unsigned char*>(positions) + index * stride);
+		return m_viewProjection * glm::vec4(p[0], p[1], p[2], 1.0f);
+	};
+
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		clipTriangle(vertex(indices[i]), vertex(indices[i + 1]), vertex(indices[i + 2]));
+	}
+}
+
+void OcclusionCuller::endOccluders()
+{
+	for (size_t level = 1; level < m_levels.size(); ++level)
+	{
+		const std::vector<float>& src = m_levels[level - 1];
+		std::vector<float>& dst = m_levels[level];
+		glm::ivec2 srcSize = m_levelSizes[level - 1];
+		glm::ivec2 dstSize = m_levelSizes[level];
+
+		for (int y = 0; y < dstSize.y; ++y)
+		{
+			int y0 = y * 2, y1 = std::min(y * 2 + 1, srcSize.y - 1);
+			for (int x = 0; x < dstSize.x; ++x)
+			{
+				int x0 = x * 2, x1 = std::min(x * 2 + 1, srcSize.x - 1);
+				dst[y * dstSize.x + x] = std::max(
+					std::max(src[y0 * srcSize.x + x0], src[y0 * srcSize.x + x1]),
+					std::max(src[y1 * srcSize.x + x0], src[y1 * srcSize.x + x1]));
+			}
+		}
+	}
+}
+
+bool OcclusionCuller::isVisible(const AABB& box)
+{
+	m_stats.tested++;
+
+	float minX = static_cast<float>(m_width), maxX = 0.0f;
+	float minY = static_cast<float>(m_height), maxY = 0.0f;
+	float nearest = FAR_DEPTH;
+
+	for (int i = 0; i < 8; ++i)
+	{
+		glm::vec4 clip = m_viewProjection * glm::vec4(
+			static_cast<float>((i & 1) ? box.maxX : box.minX),
+			static_cast<float>((i & 2) ? box.maxY : box.minY),
+			static_cast<float>((i & 4) ? box.maxZ : box.minZ),
+			1.0f
+		);
+
+		// Boxes reaching past the near plane are never culled
+		if (clip.z + clip.w < 0.0f || clip.w < NEAR_W)
+		{
+			m_stats.visible++;
+			return true;
+		}
+
+		glm::vec4 s = toScreen(clip);
+		minX = std::min(minX, s.x); maxX = std::max(maxX, s.x);
+		minY = std::min(minY, s.y); maxY = std::max(maxY, s.y);
+		nearest = std::min(nearest, s.z);
+	}
+
+	int x0 = std::max(0, static_cast<int>(std::floor(minX)));
+	int x1 = std::min(m_width - 1, static_cast<int>(std::floor(maxX)));
+	int y0 = std::max(0, static_cast<int>(std::floor(minY)));
+	int y1 = std::min(m_height - 1, static_cast<int>(std::floor(maxY)));
+
+	// Off screen boxes are left to the frustum test
+	if (x0 > x1 || y0 > y1)
+	{
+		m_stats.visible++;
+		return true;
+	}
+
+	// Pick the level where the rect spans at most 2 texels, so only a handful get read
+	int span = std::max(x1 - x0, y1 - y0);
+	int level = 0;
+	while ((span >> level) > 1 && level + 1 < static_cast<int>(m_levels.size()))
+	{
+		level++;
+	}
+
+	const std::vector<float>& depth = m_levels[level];
+	int levelWidth = m_levelSizes[level].x;
+
+	for (int y = y0 >> level; y <= (y1 >> level); ++y)
+	{
+		for (int x = x0 >> level; x <= (x1 >> level); ++x)
+		{
+			if (nearest <= depth[y * levelWidth + x])
+			{
+				m_stats.visible++;
+				return true;
+			}
+		}
+	}
+
+	m_stats.culled++;
+	return false;
+}
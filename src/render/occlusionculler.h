@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+#include <mat4x4.hpp>
+#include <vec4.hpp>
+#include "../physics/aabb.h"
+
+// CPU occlusion culling. Occluders are rasterized into a small depth buffer,
+// which is reduced into a max depth pyramid that boxes are then tested against.
+// Runs entirely on the CPU so it needs no GL context
+class OcclusionCuller
+{
+public:
+	struct Stats
+	{
+		size_t occluderTriangles = 0;
+		size_t tested = 0;
+		size_t visible = 0;
+		size_t culled = 0;
+	};
+
+private:
+	int m_width;
+	int m_height;
+
+	// Row pitch rounded up to 4 floats so the rasterizer can always write whole groups
+	int m_pitch;
+
+	glm::mat4 m_viewProjection { 1.0f };
+
+	// Level 0 is the rasterized depth, each level after holds the farthest depth of 2x2 texels below it
+	std::vector<std::vector<float>> m_levels;
+	std::vector<glm::ivec2> m_levelSizes;
+
+	Stats m_stats;
+
+	glm::vec4 toScreen(const glm::vec4& clip) const;
+
+	void rasterizeTriangle(glm::vec4 a, glm::vec4 b, glm::vec4 c);
+
+	void clipTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+
+public:
+	OcclusionCuller(int width = 256, int height = 128);
+
+	// Clears the depth buffer, viewProjection is camera.getProjection() * camera.getView()
+	void beginFrame(const glm::mat4& viewProjection);
+
+	// The box has to be completely solid, like a fully opaque chunk section
+	void addOccluder(const AABB& box);
+
+	// Indexed triangle list, positions are 3 floats at the start of every stride bytes
+	void addOccluder(const float* positions, size_t stride, const unsigned int* indices, size_t indexCount);
+
+	// Builds the depth pyramid, call after the last occluder and before testing
+	void endOccluders();
+
+	// False only if the box is certainly hidden behind the occluders
+	bool isVisible(const AABB& box);
+
+	const Stats& getStats() const
+	{
+		return m_stats;
+	}
+
+	int getWidth() const { return m_width; }
+
+	int getHeight() const { return m_height; }
+
+	// Rasterized depth of one row, for debug views
+	const float* getDepthRow(int y) const
+	{
+		return m_levels[0].data() + y * m_pitch;
+	}
+};
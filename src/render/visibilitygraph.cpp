@@ -0,0 +1,91 @@
+#include "visibilitygraph.h"
+#include "frustum.h"
+#include "../physics/aabb.h"
+#include "../world/chunk.h"
+#include "../world/chunkmesher.h"
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+static const int DIRECTIONS[FACE_COUNT][3] = { { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 }, { -1, 0, 0 }, { 1, 0, 0 } };
+
+static int opposite(int face)
+{
+	return face ^ 1;
+}
+
+void VisibilityGraph::setConnectivity(const SectionPos& pos, uint16_t connectivity)
+{
+	m_connectivity[pos] = connectivity;
+}
+
+void VisibilityGraph::remove(const SectionPos& pos)
+{
+	m_connectivity.erase(pos);
+}
+
+void VisibilityGraph::search(const Vec3<double>& camera, const Frustum& frustum, int maxDistance, std::vector<SectionPos>& visible)
+{
+	m_stats = Stats();
+	m_visited.clear();
+	m_queue.clear();
+	visible.clear();
+
+	const double size = ChunkSection::SIZE;
+
+	SectionPos start;
+	start.x = static_cast<int>(std::floor(camera.x / size));
+	start.y = std::min(std::max(static_cast<int>(std::floor(camera.y / size)), 0), Chunk::SECTION_COUNT - 1);
+	start.z = static_cast<int>(std::floor(camera.z / size));
+
+	m_queue.push_back({ start, FACE_COUNT, 0 });
+	m_visited.insert(start);
+
+	for (size_t head = 0; head < m_queue.size(); ++head)
+	{
+		const Node node = m_queue[head];
+		visible.push_back(node.pos);
+		++m_stats.visited;
+
+		auto it = m_connectivity.find(node.pos);
+		uint16_t connectivity = it == m_connectivity.end() ? ChunkMesher::ALL_FACES_CONNECTED : it->second;
+
+		for (int dir = 0; dir < FACE_COUNT; ++dir)
+		{
+			if (node.directions & (1 << opposite(dir)))
+			{
+				continue;
+			}
+
+			// The camera sees out of its own section in every direction
+			if (node.entryFace != FACE_COUNT && !ChunkMesher::isConnected(connectivity, node.entryFace, dir))
+			{
+				continue;
+			}
+
+			SectionPos next = { node.pos.x + DIRECTIONS[dir][0], node.pos.y + DIRECTIONS[dir][1], node.pos.z + DIRECTIONS[dir][2] };
+
+			if (next.y < 0 || next.y >= Chunk::SECTION_COUNT
+				|| std::abs(next.x - start.x) > maxDistance || std::abs(next.z - start.z) > maxDistance)
+			{
+				continue;
+			}
+
+			if (!m_visited.insert(next).second)
+			{
+				continue;
+			}
+
+			AABB bounds = { next.x * size, next.y * size, next.z * size, (next.x + 1) * size, (next.y + 1) * size, (next.z + 1) * size };
+			if (!frustum.aabbIn(bounds))
+			{
+				++m_stats.frustumCulled;
+				continue;
+			}
+
+			m_queue.push_back({ next, static_cast<uint8_t>(opposite(dir)), static_cast<uint8_t>(node.directions | (1 << dir)) });
+		}
+	}
+
+	m_stats.visible = visible.size();
+}
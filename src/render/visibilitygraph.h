@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+#include "../world/sectionpos.h"
+#include "../utility/vec.h"
+
+class Frustum;
+
+// Finds the sections the camera can possibly see by walking outward from the camera's section,
+// only passing through a section between faces its open blocks connect. Sealed caves and solid
+// ground are never reached. The walk never turns back on a direction it has already moved in,
+// which keeps it linear in the number of sections
+class VisibilityGraph
+{
+public:
+	struct Stats
+	{
+		size_t visited = 0;
+		size_t frustumCulled = 0;
+		size_t visible = 0;
+	};
+
+private:
+	struct Node
+	{
+		SectionPos pos;
+
+		// Face the walk came in through, FACE_COUNT for the camera's own section
+		uint8_t entryFace;
+
+		// Bit per BlockFace direction moved in so far
+		uint8_t directions;
+	};
+
+	// Sections that were never meshed count as fully open
+	std::unordered_map<SectionPos, uint16_t> m_connectivity;
+
+	std::unordered_set<SectionPos> m_visited;
+	std::vector<Node> m_queue;
+
+	Stats m_stats;
+
+public:
+	// From ChunkMesher::Mesh::connectivity
+	void setConnectivity(const SectionPos& pos, uint16_t connectivity);
+
+	void remove(const SectionPos& pos);
+
+	// Fills visible nearest first, ready for ChunkRenderer::prepare. Sections more than
+	// maxDistance sections away horizontally are never visited
+	void search(const Vec3<double>& camera, const Frustum& frustum, int maxDistance, std::vector<SectionPos>& visible);
+
+	const Stats& getStats() const { return m_stats; }
+};
@@ -738,6 +738,11 @@ struct ContentBrowser
 };
 
 ContentBrowser browser;
+void Window::addDebugPanel(const std::string& title, std::function<std::string()> text)
+{
+    m_debugPanels.push_back({ title, std::move(text) });
+}
+
 void Window::endDrawing()
 {
     if (m_debugWindow)
@@ -792,6 +797,13 @@ void Window::endDrawing()
 
         browser.Draw();
 
+        for (const DebugPanel& panel : m_debugPanels)
+        {
+            ImGui::Begin(panel.title.c_str());
+            ImGui::TextUnformatted(panel.text().c_str());
+            ImGui::End();
+        }
+
         ImGui::Render();
 
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <functional>
 #include "../graphics/image.h"
 
 typedef struct GLFWwindow GLFWwindow;
@@ -14,6 +16,14 @@ private:
 
     bool m_debugWindow = false;
 
+    struct DebugPanel
+    {
+        std::string title;
+        std::function<std::string()> text;
+    };
+
+    std::vector<DebugPanel> m_debugPanels;
+
 public:
     Window() = default;
 
@@ -51,6 +61,9 @@ public:
 
     const bool isDebugEnabled() const { return m_debugWindow; }
 
+    // Adds a panel to the debug window showing whatever text returns, called every frame it's open
+    void addDebugPanel(const std::string& title, std::function<std::string()> text);
+
     std::string getCaption();
 
     void setCaption(const std::string& caption);
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace Checksum
+{
+    // Standard reflected CRC-32 (polynomial 0xEDB88320), matching zlib's crc32()
+    inline uint32_t crc32(const void* data, size_t size, uint32_t crc = 0)
+    {
+        struct Table
+        {
+            uint32_t entries[8][256];
+
+            Table()
+            {
+                for (uint32_t i = 0; i < 256; ++i)
+                {
+                    uint32_t value = i;
+                    for (int bit = 0; bit < 8; ++bit)
+                    {
+                        value = (value >> 1) ^ (0xEDB88320u & (0u - (value & 1)));
+                    }
+                    entries[0][i] = value;
+                }
+
+                for (uint32_t i = 0; i < 256; ++i)
+                {
+                    for (int slice = 1; slice < 8; ++slice)
+                    {
+                        entries[slice][i] = (entries[slice - 1][i] >> 8) ^ entries[0][entries[slice - 1][i] & 0xFF];
+                    }
+                }
+            }
+        };
+
+        static const Table table;
+        const auto& t = table.entries;
+
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        crc = ~crc;
+
+        // Slicing by 8, one table lookup per byte but no dependency between them within a block
+        while (size >= 8)
+        {
+            uint32_t low = (bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<uint32_t>(bytes[3]) << 24)) ^ crc;
+            crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24]
+                ^ t[3][bytes[4]] ^ t[2][bytes[5]] ^ t[1][bytes[6]] ^ t[0][bytes[7]];
+
+            bytes += 8;
+            size -= 8;
+        }
+
+        while (size-- > 0)
+        {
+            crc = (crc >> 8) ^ t[0][(crc ^ *bytes++) & 0xFF];
+        }
+
+        return ~crc;
+    }
+}
@@ -0,0 +1,640 @@
+#include "noise.h"
+#include "random.h"
+#include <cstring>
+#include <algorithm>
+
+#if defined(__AVX2__)
+#define NOISE_AVX2
+#define NOISE_SSE2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NOISE_SSE2
+#include <emmintrin.h>
+#endif
+
+// The kernels below are written once against F (float lanes) and I (int32 lanes) and only use
+// operations that round the same way at every width. Results match across paths as long as the
+// compiler doesn't contract multiply-adds into FMAs, which MSVC and GCC only do when asked to
+
+namespace Scalar
+{
+    struct F
+    {
+        static constexpr int WIDTH = 1;
+
+        float v;
+
+        F() = default;
+        F(float value) : v(value) {}
+
+        // 0, 1, 2... across the lanes
+        static F lanes() { return 0.0f; }
+    };
+
+    struct I
+    {
+        int32_t v;
+
+        I() = default;
+        I(int32_t value) : v(value) {}
+    };
+
+    inline F operator+(F a, F b) { return a.v + b.v; }
+    inline F operator-(F a, F b) { return a.v - b.v; }
+    inline F operator*(F a, F b) { return a.v * b.v; }
+
+    // Through unsigned so overflow wraps like the vector paths instead of being undefined
+    inline I operator+(I a, I b) { return static_cast<int32_t>(static_cast<uint32_t>(a.v) + static_cast<uint32_t>(b.v)); }
+    inline I operator*(I a, I b) { return static_cast<int32_t>(static_cast<uint32_t>(a.v) * static_cast<uint32_t>(b.v)); }
+    inline I operator^(I a, I b) { return a.v ^ b.v; }
+    inline I operator&(I a, I b) { return a.v & b.v; }
+    inline I operator|(I a, I b) { return a.v | b.v; }
+    inline I operator>>(I a, int bits) { return static_cast<int32_t>(static_cast<uint32_t>(a.v) >> bits); }
+    inline I operator<<(I a, int bits) { return static_cast<int32_t>(static_cast<uint32_t>(a.v) << bits); }
+
+    inline F fastFloor(F a)
+    {
+        float truncated = static_cast<float>(static_cast<int32_t>(a.v));
+        return a.v < truncated ? truncated - 1.0f : truncated;
+    }
+
+    inline I toInt(F a) { return static_cast<int32_t>(a.v); }
+    inline F toFloat(I a) { return static_cast<float>(a.v); }
+
+    inline I lessThan(F a, F b) { return a.v < b.v ? -1 : 0; }
+    inline I greaterEqual(F a, F b) { return a.v >= b.v ? -1 : 0; }
+    inline I lessThan(I a, I b) { return a.v < b.v ? -1 : 0; }
+    inline I equal(I a, I b) { return a.v == b.v ? -1 : 0; }
+
+    inline F select(I mask, F a, F b) { return mask.v ? a : b; }
+
+    // Flips the sign wherever bit 31 of bits is set
+    inline F flipSign(F a, I bits)
+    {
+        uint32_t raw;
+        std::memcpy(&raw, &a.v, sizeof(raw));
+        raw ^= static_cast<uint32_t>(bits.v) & 0x80000000u;
+        std::memcpy(&a.v, &raw, sizeof(raw));
+        return a;
+    }
+
+    inline void store(float* data, F a) { *data = a.v; }
+}
+
+#if defined(NOISE_SSE2)
+namespace Sse2
+{
+    struct F
+    {
+        static constexpr int WIDTH = 4;
+
+        __m128 v;
+
+        F() = default;
+        F(__m128 value) : v(value) {}
+        F(float value) : v(_mm_set1_ps(value)) {}
+
+        static F lanes() { return _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f); }
+    };
+
+    struct I
+    {
+        __m128i v;
+
+        I() = default;
+        I(__m128i value) : v(value) {}
+        I(int32_t value) : v(_mm_set1_epi32(value)) {}
+    };
+
+    inline F operator+(F a, F b) { return _mm_add_ps(a.v, b.v); }
+    inline F operator-(F a, F b) { return _mm_sub_ps(a.v, b.v); }
+    inline F operator*(F a, F b) { return _mm_mul_ps(a.v, b.v); }
+
+    inline I operator+(I a, I b) { return _mm_add_epi32(a.v, b.v); }
+    inline I operator^(I a, I b) { return _mm_xor_si128(a.v, b.v); }
+    inline I operator&(I a, I b) { return _mm_and_si128(a.v, b.v); }
+    inline I operator|(I a, I b) { return _mm_or_si128(a.v, b.v); }
+    inline I operator>>(I a, int bits) { return _mm_srli_epi32(a.v, bits); }
+    inline I operator<<(I a, int bits) { return _mm_slli_epi32(a.v, bits); }
+
+    // SSE2 has no 32 bit low multiply, do the even and odd lanes as 64 bit products and interleave
+    inline I operator*(I a, I b)
+    {
+        __m128i even = _mm_mul_epu32(a.v, b.v);
+        __m128i odd = _mm_mul_epu32(_mm_srli_si128(a.v, 4), _mm_srli_si128(b.v, 4));
+        return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    }
+
+    inline F fastFloor(F a)
+    {
+        __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+        return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmplt_ps(a.v, truncated), _mm_set1_ps(1.0f)));
+    }
+
+    inline I toInt(F a) { return _mm_cvttps_epi32(a.v); }
+    inline F toFloat(I a) { return _mm_cvtepi32_ps(a.v); }
+
+    inline I lessThan(F a, F b) { return _mm_castps_si128(_mm_cmplt_ps(a.v, b.v)); }
+    inline I greaterEqual(F a, F b) { return _mm_castps_si128(_mm_cmpge_ps(a.v, b.v)); }
+    inline I lessThan(I a, I b) { return _mm_cmplt_epi32(a.v, b.v); }
+    inline I equal(I a, I b) { return _mm_cmpeq_epi32(a.v, b.v); }
+
+    inline F select(I mask, F a, F b)
+    {
+        __m128 m = _mm_castsi128_ps(mask.v);
+        return _mm_or_ps(_mm_and_ps(m, a.v), _mm_andnot_ps(m, b.v));
+    }
+
+    inline F flipSign(F a, I bits) { return _mm_xor_ps(a.v, _mm_castsi128_ps(_mm_and_si128(bits.v, _mm_set1_epi32(INT32_MIN)))); }
+
+    inline void store(float* data, F a) { _mm_storeu_ps(data, a.v); }
+}
+#endif
+
+#if defined(NOISE_AVX2)
+namespace Avx2
+{
+    struct F
+    {
+        static constexpr int WIDTH = 8;
+
+        __m256 v;
+
+        F() = default;
+        F(__m256 value) : v(value) {}
+        F(float value) : v(_mm256_set1_ps(value)) {}
+
+        static F lanes() { return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f); }
+    };
+
+    struct I
+    {
+        __m256i v;
+
+        I() = default;
+        I(__m256i value) : v(value) {}
+        I(int32_t value) : v(_mm256_set1_epi32(value)) {}
+    };
+
+    inline F operator+(F a, F b) { return _mm256_add_ps(a.v, b.v); }
+    inline F operator-(F a, F b) { return _mm256_sub_ps(a.v, b.v); }
+    inline F operator*(F a, F b) { return _mm256_mul_ps(a.v, b.v); }
+
+    inline I operator+(I a, I b) { return _mm256_add_epi32(a.v, b.v); }
+    inline I operator*(I a, I b) { return _mm256_mullo_epi32(a.v, b.v); }
+    inline I operator^(I a, I b) { return _mm256_xor_si256(a.v, b.v); }
+    inline I operator&(I a, I b) { return _mm256_and_si256(a.v, b.v); }
+    inline I operator|(I a, I b) { return _mm256_or_si256(a.v, b.v); }
+    inline I operator>>(I a, int bits) { return _mm256_srli_epi32(a.v, bits); }
+    inline I operator<<(I a, int bits) { return _mm256_slli_epi32(a.v, bits); }
+
+    // Not _mm256_floor_ps, which keeps the sign of -0 where the other paths don't
+    inline F fastFloor(F a)
+    {
+        __m256 truncated = _mm256_cvtepi32_ps(_mm256_cvttps_epi32(a.v));
+        return _mm256_sub_ps(truncated, _mm256_and_ps(_mm256_cmp_ps(a.v, truncated, _CMP_LT_OQ), _mm256_set1_ps(1.0f)));
+    }
+
+    inline I toInt(F a) { return _mm256_cvttps_epi32(a.v); }
+    inline F toFloat(I a) { return _mm256_cvtepi32_ps(a.v); }
+
+    inline I lessThan(F a, F b) { return _mm256_castps_si256(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)); }
+    inline I greaterEqual(F a, F b) { return _mm256_castps_si256(_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)); }
+    inline I lessThan(I a, I b) { return _mm256_cmpgt_epi32(b.v, a.v); }
+    inline I equal(I a, I b) { return _mm256_cmpeq_epi32(a.v, b.v); }
+
+    inline F select(I mask, F a, F b) { return _mm256_blendv_ps(b.v, a.v, _mm256_castsi256_ps(mask.v)); }
+
+    inline F flipSign(F a, I bits) { return _mm256_xor_ps(a.v, _mm256_castsi256_ps(_mm256_and_si256(bits.v, _mm256_set1_epi32(INT32_MIN)))); }
+
+    inline void store(float* data, F a) { _mm256_storeu_ps(data, a.v); }
+}
+#endif
+
+namespace
+{
+    constexpr int32_t PRIME_X = 501125321;
+    constexpr int32_t PRIME_Y = 1136930381;
+    constexpr int32_t PRIME_Z = 1720413743;
+
+    // Seeds of the warp offsets, kept apart from the octave seeds
+    constexpr int32_t WARP_SEED_X = 0x5F3759DF;
+    constexpr int32_t WARP_SEED_Y = 0x1B873593;
+    constexpr int32_t WARP_SEED_Z = 0x68E31DA4;
+
+    // Bring each noise to roughly [-1, 1], measured over a few million samples. Value noise is
+    // there already
+    constexpr float PERLIN_SCALE = 1.0f;
+    constexpr float SIMPLEX_2D_SCALE = 70.0f;
+    constexpr float SIMPLEX_3D_SCALE = 32.0f;
+
+    // Coordinates arrive already multiplied by their prime
+    template<typename I>
+    I hash(I seed, I x, I y, I z)
+    {
+        I h = seed ^ x ^ y ^ z;
+        h = h * I(0x27D4EB2D);
+        return h ^ (h >> 15);
+    }
+
+    template<typename F>
+    F lerp(F a, F b, F t)
+    {
+        return a + (b - a) * t;
+    }
+
+    template<typename F>
+    F fade(F t)
+    {
+        return t * t * t * (t * (t * F(6.0f) - F(15.0f)) + F(10.0f));
+    }
+
+    template<typename F, typename I>
+    F toUnit(I mask)
+    {
+        return select(mask, F(1.0f), F(0.0f));
+    }
+
+    // Dot product with one of the 12 cube edge directions picked by the low hash bits
+    template<typename F, typename I>
+    F gradient(I h, F x, F y, F z)
+    {
+        I index = h & I(15);
+        F u = select(lessThan(index, I(8)), x, y);
+        F v = select(lessThan(index, I(4)), y, select(equal(index, I(12)) | equal(index, I(14)), x, z));
+        return flipSign(u, h << 31) + flipSign(v, h << 30);
+    }
+
+    template<typename F, typename I>
+    F valueAt(I h)
+    {
+        return toFloat(h >> 8) * F(1.0f / 8388608.0f) - F(1.0f);
+    }
+
+    template<typename F, typename I>
+    F perlin(I seed, F x, F y)
+    {
+        F xs = fastFloor(x), ys = fastFloor(y);
+        I x0 = toInt(xs) * I(PRIME_X), y0 = toInt(ys) * I(PRIME_Y);
+        I x1 = x0 + I(PRIME_X), y1 = y0 + I(PRIME_Y);
+
+        F fx0 = x - xs, fy0 = y - ys;
+        F fx1 = fx0 - F(1.0f), fy1 = fy0 - F(1.0f);
+        F u = fade(fx0), v = fade(fy0);
+
+        F zero(0.0f);
+        I none(0);
+        F a = lerp(gradient(hash(seed, x0, y0, none), fx0, fy0, zero), gradient(hash(seed, x1, y0, none), fx1, fy0, zero), u);
+        F b = lerp(gradient(hash(seed, x0, y1, none), fx0, fy1, zero), gradient(hash(seed, x1, y1, none), fx1, fy1, zero), u);
+        return lerp(a, b, v) * F(PERLIN_SCALE);
+    }
+
+    template<typename F, typename I>
+    F perlin(I seed, F x, F y, F z)
+    {
+        F xs = fastFloor(x), ys = fastFloor(y), zs = fastFloor(z);
+        I x0 = toInt(xs) * I(PRIME_X), y0 = toInt(ys) * I(PRIME_Y), z0 = toInt(zs) * I(PRIME_Z);
+        I x1 = x0 + I(PRIME_X), y1 = y0 + I(PRIME_Y), z1 = z0 + I(PRIME_Z);
+
+        F fx0 = x - xs, fy0 = y - ys, fz0 = z - zs;
+        F fx1 = fx0 - F(1.0f), fy1 = fy0 - F(1.0f), fz1 = fz0 - F(1.0f);
+        F u = fade(fx0), v = fade(fy0), w = fade(fz0);
+
+        F a = lerp(gradient(hash(seed, x0, y0, z0), fx0, fy0, fz0), gradient(hash(seed, x1, y0, z0), fx1, fy0, fz0), u);
+        F b = lerp(gradient(hash(seed, x0, y1, z0), fx0, fy1, fz0), gradient(hash(seed, x1, y1, z0), fx1, fy1, fz0), u);
+        F c = lerp(gradient(hash(seed, x0, y0, z1), fx0, fy0, fz1), gradient(hash(seed, x1, y0, z1), fx1, fy0, fz1), u);
+        F d = lerp(gradient(hash(seed, x0, y1, z1), fx0, fy1, fz1), gradient(hash(seed, x1, y1, z1), fx1, fy1, fz1), u);
+        return lerp(lerp(a, b, v), lerp(c, d, v), w) * F(PERLIN_SCALE);
+    }
+
+    template<typename F, typename I>
+    F value(I seed, F x, F y)
+    {
+        F xs = fastFloor(x), ys = fastFloor(y);
+        I x0 = toInt(xs) * I(PRIME_X), y0 = toInt(ys) * I(PRIME_Y);
+        I x1 = x0 + I(PRIME_X), y1 = y0 + I(PRIME_Y);
+        F u = fade(x - xs), v = fade(y - ys);
+
+        I none(0);
+        F a = lerp(valueAt<F>(hash(seed, x0, y0, none)), valueAt<F>(hash(seed, x1, y0, none)), u);
+        F b = lerp(valueAt<F>(hash(seed, x0, y1, none)), valueAt<F>(hash(seed, x1, y1, none)), u);
+        return lerp(a, b, v);
+    }
+
+    template<typename F, typename I>
+    F value(I seed, F x, F y, F z)
+    {
+        F xs = fastFloor(x), ys = fastFloor(y), zs = fastFloor(z);
+        I x0 = toInt(xs) * I(PRIME_X), y0 = toInt(ys) * I(PRIME_Y), z0 = toInt(zs) * I(PRIME_Z);
+        I x1 = x0 + I(PRIME_X), y1 = y0 + I(PRIME_Y), z1 = z0 + I(PRIME_Z);
+        F u = fade(x - xs), v = fade(y - ys), w = fade(z - zs);
+
+        F a = lerp(valueAt<F>(hash(seed, x0, y0, z0)), valueAt<F>(hash(seed, x1, y0, z0)), u);
+        F b = lerp(valueAt<F>(hash(seed, x0, y1, z0)), valueAt<F>(hash(seed, x1, y1, z0)), u);
+        F c = lerp(valueAt<F>(hash(seed, x0, y0, z1)), valueAt<F>(hash(seed, x1, y0, z1)), u);
+        F d = lerp(valueAt<F>(hash(seed, x0, y1, z1)), valueAt<F>(hash(seed, x1, y1, z1)), u);
+        return lerp(lerp(a, b, v), lerp(c, d, v), w);
+    }
+
+    // Falloff of one simplex corner, zero outside its radius
+    template<typename F, typename I>
+    F corner(F t, I h, F x, F y, F z)
+    {
+        t = select(lessThan(t, F(0.0f)), F(0.0f), t);
+        t = t * t;
+        return t * t * gradient(h, x, y, z);
+    }
+
+    template<typename F, typename I>
+    F simplex(I seed, F x, F y)
+    {
+        const float SKEW = 0.366025403784438646763723170752936183f;
+        const float UNSKEW = 0.211324865405187117745425609748864533f;
+
+        F s = (x + y) * F(SKEW);
+        F is = fastFloor(x + s), js = fastFloor(y + s);
+        F t = (is + js) * F(UNSKEW);
+        F x0 = x - (is - t), y0 = y - (js - t);
+
+        // Which triangle of the skewed square we're in
+        I lower = greaterEqual(x0, y0);
+        F x1 = x0 - toUnit<F>(lower) + F(UNSKEW);
+        F y1 = y0 - toUnit<F>(lower ^ I(-1)) + F(UNSKEW);
+        F x2 = x0 + F(2.0f * UNSKEW - 1.0f);
+        F y2 = y0 + F(2.0f * UNSKEW - 1.0f);
+
+        I i = toInt(is) * I(PRIME_X), j = toInt(js) * I(PRIME_Y);
+        I none(0);
+        F zero(0.0f);
+
+        F n0 = corner(F(0.5f) - x0 * x0 - y0 * y0, hash(seed, i, j, none), x0, y0, zero);
+        F n1 = corner(F(0.5f) - x1 * x1 - y1 * y1, hash(seed, i + (lower & I(PRIME_X)), j + ((lower ^ I(-1)) & I(PRIME_Y)), none), x1, y1, zero);
+        F n2 = corner(F(0.5f) - x2 * x2 - y2 * y2, hash(seed, i + I(PRIME_X), j + I(PRIME_Y), none), x2, y2, zero);
+        return (n0 + n1 + n2) * F(SIMPLEX_2D_SCALE);
+    }
+
+    template<typename F, typename I>
+    F simplex(I seed, F x, F y, F z)
+    {
+        const float SKEW = 1.0f / 3.0f;
+        const float UNSKEW = 1.0f / 6.0f;
+
+        F s = (x + y + z) * F(SKEW);
+        F is = fastFloor(x + s), js = fastFloor(y + s), ks = fastFloor(z + s);
+        F t = (is + js + ks) * F(UNSKEW);
+        F x0 = x - (is - t), y0 = y - (js - t), z0 = z - (ks - t);
+
+        // Order the offsets to find which of the six tetrahedra we're in
+        I all(-1);
+        I xy = greaterEqual(x0, y0), yz = greaterEqual(y0, z0), xz = greaterEqual(x0, z0);
+        I i1 = xy & xz, j1 = (xy ^ all) & yz, k1 = (xz ^ all) & (yz ^ all);
+        I i2 = xy | xz, j2 = (xy ^ all) | yz, k2 = (xz & yz) ^ all;
+
+        F x1 = x0 - toUnit<F>(i1) + F(UNSKEW), y1 = y0 - toUnit<F>(j1) + F(UNSKEW), z1 = z0 - toUnit<F>(k1) + F(UNSKEW);
+        F x2 = x0 - toUnit<F>(i2) + F(2.0f * UNSKEW), y2 = y0 - toUnit<F>(j2) + F(2.0f * UNSKEW), z2 = z0 - toUnit<F>(k2) + F(2.0f * UNSKEW);
+        F x3 = x0 + F(3.0f * UNSKEW - 1.0f), y3 = y0 + F(3.0f * UNSKEW - 1.0f), z3 = z0 + F(3.0f * UNSKEW - 1.0f);
+
+        I i = toInt(is) * I(PRIME_X), j = toInt(js) * I(PRIME_Y), k = toInt(ks) * I(PRIME_Z);
+        I px(PRIME_X), py(PRIME_Y), pz(PRIME_Z);
+
+        F n0 = corner(F(0.6f) - x0 * x0 - y0 * y0 - z0 * z0, hash(seed, i, j, k), x0, y0, z0);
+        F n1 = corner(F(0.6f) - x1 * x1 - y1 * y1 - z1 * z1, hash(seed, i + (i1 & px), j + (j1 & py), k + (k1 & pz)), x1, y1, z1);
+        F n2 = corner(F(0.6f) - x2 * x2 - y2 * y2 - z2 * z2, hash(seed, i + (i2 & px), j + (j2 & py), k + (k2 & pz)), x2, y2, z2);
+        F n3 = corner(F(0.6f) - x3 * x3 - y3 * y3 - z3 * z3, hash(seed, i + px, j + py, k + pz), x3, y3, z3);
+        return (n0 + n1 + n2 + n3) * F(SIMPLEX_3D_SCALE);
+    }
+
+    template<typename F, typename I>
+    F single(Noise::Type type, I seed, F x, F y)
+    {
+        switch (type)
+        {
+        case Noise::TYPE_PERLIN:
+            return perlin(seed, x, y);
+        case Noise::TYPE_VALUE:
+            return value(seed, x, y);
+        default:
+            return simplex(seed, x, y);
+        }
+    }
+
+    template<typename F, typename I>
+    F single(Noise::Type type, I seed, F x, F y, F z)
+    {
+        switch (type)
+        {
+        case Noise::TYPE_PERLIN:
+            return perlin(seed, x, y, z);
+        case Noise::TYPE_VALUE:
+            return value(seed, x, y, z);
+        default:
+            return simplex(seed, x, y, z);
+        }
+    }
+
+    float amplitudeSum(const Noise::Settings& settings)
+    {
+        float sum = 0.0f, amplitude = 1.0f;
+        for (int i = 0; i < std::max(1, settings.octaves); ++i)
+        {
+            sum += amplitude;
+            amplitude *= settings.gain;
+        }
+        return sum;
+    }
+
+    template<typename F, typename I>
+    F sample(const Noise::Settings& settings, int32_t seed, F x, F y)
+    {
+        if (settings.warpAmplitude != 0.0f)
+        {
+            F wx = x * F(settings.warpFrequency), wy = y * F(settings.warpFrequency);
+            F offsetX = single(settings.type, I(seed ^ WARP_SEED_X), wx, wy);
+            F offsetY = single(settings.type, I(seed ^ WARP_SEED_Y), wx, wy);
+            x = x + offsetX * F(settings.warpAmplitude);
+            y = y + offsetY * F(settings.warpAmplitude);
+        }
+
+        x = x * F(settings.frequency);
+        y = y * F(settings.frequency);
+
+        F sum = single(settings.type, I(seed), x, y);
+        float amplitude = 1.0f;
+
+        for (int octave = 1; octave < settings.octaves; ++octave)
+        {
+            x = x * F(settings.lacunarity);
+            y = y * F(settings.lacunarity);
+            amplitude *= settings.gain;
+            sum = sum + single(settings.type, I(seed) + I(octave), x, y) * F(amplitude);
+        }
+
+        return sum * F(1.0f / amplitudeSum(settings));
+    }
+
+    template<typename F, typename I>
+    F sample(const Noise::Settings& settings, int32_t seed, F x, F y, F z)
+    {
+        if (settings.warpAmplitude != 0.0f)
+        {
+            F wx = x * F(settings.warpFrequency), wy = y * F(settings.warpFrequency), wz = z * F(settings.warpFrequency);
+            F offsetX = single(settings.type, I(seed ^ WARP_SEED_X), wx, wy, wz);
+            F offsetY = single(settings.type, I(seed ^ WARP_SEED_Y), wx, wy, wz);
+            F offsetZ = single(settings.type, I(seed ^ WARP_SEED_Z), wx, wy, wz);
+            x = x + offsetX * F(settings.warpAmplitude);
+            y = y + offsetY * F(settings.warpAmplitude);
+            z = z + offsetZ * F(settings.warpAmplitude);
+        }
+
+        x = x * F(settings.frequency);
+        y = y * F(settings.frequency);
+        z = z * F(settings.frequency);
+
+        F sum = single(settings.type, I(seed), x, y, z);
+        float amplitude = 1.0f;
+
+        for (int octave = 1; octave < settings.octaves; ++octave)
+        {
+            x = x * F(settings.lacunarity);
+            y = y * F(settings.lacunarity);
+            z = z * F(settings.lacunarity);
+            amplitude *= settings.gain;
+            sum = sum + single(settings.type, I(seed) + I(octave), x, y, z) * F(amplitude);
+        }
+
+        return sum * F(1.0f / amplitudeSum(settings));
+    }
+
+    // Full vectors along x, the remainder of each row one lane at a time through the same kernels
+    template<typename F, typename I>
+    void fillRows(const Noise::Settings& settings, int32_t seed, float* out, const Vec2<float>& origin, const Vec2<int>& size, const Vec2<float>& step)
+    {
+        for (int y = 0; y < size.y; ++y)
+        {
+            float* row = out + static_cast<size_t>(y) * size.x;
+            F py = F(origin.y) + F(static_cast<float>(y)) * F(step.y);
+
+            int x = 0;
+            for (; x + F::WIDTH <= size.x; x += F::WIDTH)
+            {
+                F px = F(origin.x) + (F(static_cast<float>(x)) + F::lanes()) * F(step.x);
+                store(row + x, sample<F, I>(settings, seed, px, py));
+            }
+
+            for (; x < size.x; ++x)
+            {
+                Scalar::F px = Scalar::F(origin.x) + Scalar::F(static_cast<float>(x)) * Scalar::F(step.x);
+                Scalar::F pys = Scalar::F(origin.y) + Scalar::F(static_cast<float>(y)) * Scalar::F(step.y);
+                row[x] = sample<Scalar::F, Scalar::I>(settings, seed, px, pys).v;
+            }
+        }
+    }
+
+    template<typename F, typename I>
+    void fillRows(const Noise::Settings& settings, int32_t seed, float* out, const Vec3<float>& origin, const Vec3<int>& size, const Vec3<float>& step)
+    {
+        for (int y = 0; y < size.y; ++y)
+        {
+            F py = F(origin.y) + F(static_cast<float>(y)) * F(step.y);
+            Scalar::F pys = Scalar::F(origin.y) + Scalar::F(static_cast<float>(y)) * Scalar::F(step.y);
+
+            for (int z = 0; z < size.z; ++z)
+            {
+                float* row = out + (static_cast<size_t>(y) * size.z + z) * size.x;
+                F pz = F(origin.z) + F(static_cast<float>(z)) * F(step.z);
+                Scalar::F pzs = Scalar::F(origin.z) + Scalar::F(static_cast<float>(z)) * Scalar::F(step.z);
+
+                int x = 0;
+                for (; x + F::WIDTH <= size.x; x += F::WIDTH)
+                {
+                    F px = F(origin.x) + (F(static_cast<float>(x)) + F::lanes()) * F(step.x);
+                    store(row + x, sample<F, I>(settings, seed, px, py, pz));
+                }
+
+                for (; x < size.x; ++x)
+                {
+                    Scalar::F px = Scalar::F(origin.x) + Scalar::F(static_cast<float>(x)) * Scalar::F(step.x);
+                    row[x] = sample<Scalar::F, Scalar::I>(settings, seed, px, pys, pzs).v;
+                }
+            }
+        }
+    }
+}
+
+Noise::Noise() : Noise(0, Settings())
+{
+}
+
+Noise::Noise(int32_t seed, const Settings& settings) : m_seed(seed), m_settings(settings), m_simd(getSupportedSimd())
+{
+}
+
+Noise::Noise(Random& random, const Settings& settings) : Noise(random.nextInt(), settings)
+{
+}
+
+float Noise::get(float x, float y) const
+{
+    return sample<Scalar::F, Scalar::I>(m_settings, m_seed, x, y).v;
+}
+
+float Noise::get(float x, float y, float z) const
+{
+    return sample<Scalar::F, Scalar::I>(m_settings, m_seed, x, y, z).v;
+}
+
+void Noise::fillGrid(float* out, const Vec2<float>& origin, const Vec2<int>& size, const Vec2<float>& step) const
+{
+    switch (m_simd)
+    {
+#if defined(NOISE_AVX2)
+    case SIMD_AVX2:
+        fillRows<Avx2::F, Avx2::I>(m_settings, m_seed, out, origin, size, step);
+        break;
+#endif
+#if defined(NOISE_SSE2)
+    case SIMD_SSE2:
+        fillRows<Sse2::F, Sse2::I>(m_settings, m_seed, out, origin, size, step);
+        break;
+#endif
+    default:
+        fillRows<Scalar::F, Scalar::I>(m_settings, m_seed, out, origin, size, step);
+        break;
+    }
+}
+
+void Noise::fillGrid(float* out, const Vec3<float>& origin, const Vec3<int>& size, const Vec3<float>& step) const
+{
+    switch (m_simd)
+    {
+#if defined(NOISE_AVX2)
+    case SIMD_AVX2:
+        fillRows<Avx2::F, Avx2::I>(m_settings, m_seed, out, origin, size, step);
+        break;
+#endif
+#if defined(NOISE_SSE2)
+    case SIMD_SSE2:
+        fillRows<Sse2::F, Sse2::I>(m_settings, m_seed, out, origin, size, step);
+        break;
+#endif
+    default:
+        fillRows<Scalar::F, Scalar::I>(m_settings, m_seed, out, origin, size, step);
+        break;
+    }
+}
+
+Noise::Simd Noise::getSupportedSimd()
+{
+#if defined(NOISE_AVX2)
+    return SIMD_AVX2;
+#elif defined(NOISE_SSE2)
+    return SIMD_SSE2;
+#else
+    return SIMD_SCALAR;
+#endif
+}
+
+void Noise::setSimd(Simd simd)
+{
+    m_simd = std::min(simd, getSupportedSimd());
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include "vec.h"
+
+class Random;
+
+// Simplex, Perlin and value noise with fBm octaves and domain warping. Every sample goes through
+// the same kernels whether they run one lane at a time or 4 (SSE2) or 8 (AVX2) wide, so a grid
+// comes out bit for bit the same on every path the build supports
+class Noise
+{
+public:
+    enum Type
+    {
+        TYPE_SIMPLEX,
+        TYPE_PERLIN,
+        TYPE_VALUE
+    };
+
+    enum Simd
+    {
+        SIMD_SCALAR,
+        SIMD_SSE2,
+        SIMD_AVX2
+    };
+
+    struct Settings
+    {
+        Type type = TYPE_SIMPLEX;
+
+        // Applied to sample positions before anything else
+        float frequency = 0.01f;
+
+        int octaves = 1;
+        float lacunarity = 2.0f;
+        float gain = 0.5f;
+
+        // Sample positions are pushed around by another noise this far, 0 turns warping off
+        float warpAmplitude = 0.0f;
+        float warpFrequency = 0.01f;
+    };
+
+private:
+    int32_t m_seed;
+    Settings m_settings;
+    Simd m_simd;
+
+public:
+    // Seed 0 and default settings
+    Noise();
+
+    Noise(int32_t seed, const Settings& settings);
+
+    // Seeded from the next value of random, so noises created in the same order from an equally
+    // seeded Random come out the same
+    Noise(Random& random, const Settings& settings);
+
+    // Roughly in [-1, 1]
+    float get(float x, float y) const;
+    float get(float x, float y, float z) const;
+
+    // Samples size.x * size.y points starting at origin, out[y * size.x + x]. y here is the second
+    // horizontal axis, world z for terrain
+    void fillGrid(float* out, const Vec2<float>& origin, const Vec2<int>& size, const Vec2<float>& step) const;
+
+    // Samples a box of points, out[(y * size.z + z) * size.x + x] which for a 16x16x16 box is the
+    // block order of a chunk section
+    void fillGrid(float* out, const Vec3<float>& origin, const Vec3<int>& size, const Vec3<float>& step) const;
+
+    // Widest path this build was compiled for
+    static Simd getSupportedSimd();
+
+    // Limits the path used, for comparing paths against each other. Never goes above what's supported
+    void setSimd(Simd simd);
+
+    Simd getSimd() const { return m_simd; }
+
+    int32_t getSeed() const { return m_seed; }
+
+    void setSettings(const Settings& settings) { m_settings = settings; }
+
+    const Settings& getSettings() const { return m_settings; }
+};
@@ -1,14 +1,108 @@
 #include "random.h"
 #include <cmath>
+#include <atomic>
+#include <chrono>
 
 constexpr auto RANDOM_MULTIPLIER = 0x5DEECE66DULL;
 constexpr auto RANDOM_ADDEND = 0xBULL;
 constexpr auto RANDOM_MASK = ((1ULL << 48u) - 1);
 constexpr auto DOUBLE_UNIT = 0x1.0p-53;
+constexpr auto FLOAT_UNIT = 0x1.0p-24f;
+
+// Streams the batch functions step side by side
+constexpr size_t RANDOM_LANES = 4;
+
+namespace
+{
+    // Multiplier and addend that take the generator count steps at once
+    struct Jump
+    {
+        uint64_t multiplier;
+        uint64_t addend;
+    };
+
+    constexpr Jump jumpBy(uint64_t count)
+    {
+        Jump total { 1, 0 };
+        Jump power { RANDOM_MULTIPLIER, RANDOM_ADDEND };
+
+        for (; count; count >>= 1u)
+        {
+            if (count & 1u)
+            {
+                total.multiplier = (total.multiplier * power.multiplier) & RANDOM_MASK;
+                total.addend = (total.addend * power.multiplier + power.addend) & RANDOM_MASK;
+            }
+
+            power.addend = ((power.multiplier + 1) * power.addend) & RANDOM_MASK;
+            power.multiplier = (power.multiplier * power.multiplier) & RANDOM_MASK;
+        }
+
+        return total;
+    }
+
+    constexpr Jump LANE_JUMP = jumpBy(RANDOM_LANES);
+
+    uint64_t step(uint64_t seed)
+    {
+        return (seed * RANDOM_MULTIPLIER + RANDOM_ADDEND) & RANDOM_MASK;
+    }
+
+    // Calls draw(state) for count consecutive steps from seed and returns the last state. Each lane
+    // takes every RANDOM_LANES-th step, which breaks the chain of dependent multiplies up
+    template<typename T, typename Draw>
+    uint64_t generate(uint64_t seed, T* out, size_t count, Draw draw)
+    {
+        uint64_t lanes[RANDOM_LANES];
+        uint64_t state = seed;
+        for (size_t lane = 0; lane < RANDOM_LANES; ++lane)
+        {
+            state = step(state);
+            lanes[lane] = state;
+        }
+
+        size_t i = 0;
+        for (; i + RANDOM_LANES <= count; i += RANDOM_LANES)
+        {
+            for (size_t lane = 0; lane < RANDOM_LANES; ++lane)
+            {
+                out[i + lane] = draw(lanes[lane]);
+                lanes[lane] = (lanes[lane] * LANE_JUMP.multiplier + LANE_JUMP.addend) & RANDOM_MASK;
+            }
+        }
+
+        // The lanes have run one jump past the last full group, pick the state up from the start instead
+        Jump jump = jumpBy(i);
+        seed = (seed * jump.multiplier + jump.addend) & RANDOM_MASK;
+
+        for (; i < count; ++i)
+        {
+            seed = step(seed);
+            out[i] = draw(seed);
+        }
+
+        return seed;
+    }
+
+    // The two multipliers Java generators mix chunk coordinates with, taken straight from the world
+    // seed's first two longs
+    void getChunkMultipliers(int64_t worldSeed, uint64_t& a, uint64_t& b)
+    {
+        Random random(worldSeed);
+        a = random.nextLong();
+        b = random.nextLong();
+    }
+}
 
 Random::Random()
 {
-    m_seed = rand();
+    // Different on every call even within one clock tick, like Java's seed uniquifier
+    static std::atomic<uint64_t> uniquifier { 8682522807148012ULL };
+
+    uint64_t current = uniquifier.load(std::memory_order_relaxed);
+    while (!uniquifier.compare_exchange_weak(current, current * 1181783497276652981ULL, std::memory_order_relaxed));
+
+    setSeed((current * 1181783497276652981ULL) ^ static_cast<uint64_t>(std::chrono::high_resolution_clock::now().time_since_epoch().count()));
 }
 
 Random::Random(long long seed)
@@ -18,7 +112,7 @@ Random::Random(long long seed)
 
 int32_t Random::next(int bits)
 {
-    m_seed = (m_seed * RANDOM_MULTIPLIER + RANDOM_ADDEND) & RANDOM_MASK;
+    m_seed = step(m_seed);
     return static_cast<int32_t>(m_seed >> (48u - bits));
 }
 
@@ -30,24 +124,25 @@ int32_t Random::nextInt()
 int Random::nextInt(uint32_t bound)
 {
     int32_t r = next(31);
-    const uint16_t m = bound - 1u;
+    const uint32_t m = bound - 1u;
     if ((bound & m) == 0)
     {
         r = (int32_t)((bound * (uint64_t)r) >> 31u);
     }
-    else for (int32_t u = r; u - (r = u % bound) + m < 0; u = next(31));
+    // Rejects the top values that would make some results more likely, the test overflows like Java's
+    else for (int32_t u = r; static_cast<int32_t>(static_cast<uint32_t>(u) - static_cast<uint32_t>(r = u % static_cast<int32_t>(bound)) + m) < 0; u = next(31));
 
     return r;
 }
 
 bool Random::nextBool()
 {
-    return (nextInt(2) == 0);
+    return next(1) != 0;
 }
 
 float Random::nextFloat()
 {
-    return static_cast<float>(nextDouble());
+    return next(24) * FLOAT_UNIT;
 }
 
 double Random::nextDouble()
@@ -63,4 +158,42 @@ void Random::setSeed(uint64_t seed)
 unsigned long long Random::nextLong()
 {
     return (static_cast<unsigned long long>(next(32)) << 32u) + next(32);
-}
\ No newline at end of file
+}
+
+void Random::nextInts(int32_t* out, size_t count)
+{
+    m_seed = generate(m_seed, out, count, [](uint64_t seed) { return static_cast<int32_t>(seed >> 16u); });
+}
+
+void Random::nextFloats(float* out, size_t count)
+{
+    m_seed = generate(m_seed, out, count, [](uint64_t seed) { return static_cast<int32_t>(seed >> 24u) * FLOAT_UNIT; });
+}
+
+void Random::skip(uint64_t count)
+{
+    Jump jump = jumpBy(count);
+    m_seed = (m_seed * jump.multiplier + jump.addend) & RANDOM_MASK;
+}
+
+int64_t Random::getCarverSeed(int64_t worldSeed, int chunkX, int chunkZ)
+{
+    uint64_t a, b;
+    getChunkMultipliers(worldSeed, a, b);
+    return static_cast<int64_t>((static_cast<uint64_t>(chunkX) * a) ^ (static_cast<uint64_t>(chunkZ) * b) ^ static_cast<uint64_t>(worldSeed));
+}
+
+int64_t Random::getPopulationSeed(int64_t worldSeed, int blockX, int blockZ)
+{
+    // Unlike the carver seed, population forces both multipliers odd
+    uint64_t a, b;
+    getChunkMultipliers(worldSeed, a, b);
+    a |= 1u;
+    b |= 1u;
+    return static_cast<int64_t>((static_cast<uint64_t>(blockX) * a + static_cast<uint64_t>(blockZ) * b) ^ static_cast<uint64_t>(worldSeed));
+}
+
+int64_t Random::getDecorationSeed(int64_t populationSeed, int index, int step)
+{
+    return static_cast<int64_t>(static_cast<uint64_t>(populationSeed) + static_cast<uint64_t>(static_cast<int64_t>(index)) + static_cast<uint64_t>(static_cast<int64_t>(step) * 10000));
+}
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
 
+// Same generator as java.util.Random, so a seed gives the same values here as it does in Java
 class Random
 {
 public:
@@ -16,7 +18,22 @@ public:
     float nextFloat();
     double nextDouble();
     unsigned long long nextLong();
+
+    // Same values as calling nextInt() or nextFloat() count times, but several steps of the
+    // generator are worked on at once instead of each waiting for the one before
+    void nextInts(int32_t* out, size_t count);
+    void nextFloats(float* out, size_t count);
+
+    // Moves the generator on as if count values of up to 32 bits had been drawn, in log(count) steps
+    void skip(uint64_t count);
+
+    // Per chunk seeds the way Java terrain generators derive them, so each chunk gets its own stream
+    // whatever order chunks are generated in. Carver seeds are per chunk, population seeds take
+    // block coordinates and decoration seeds split a population seed per feature and step
+    static int64_t getCarverSeed(int64_t worldSeed, int chunkX, int chunkZ);
+    static int64_t getPopulationSeed(int64_t worldSeed, int blockX, int blockZ);
+    static int64_t getDecorationSeed(int64_t populationSeed, int index, int step);
 private:
     uint64_t m_seed = 0;
     int next(int bits);
-};
\ No newline at end of file
+};
@@ -0,0 +1,160 @@
+#include "threadpool.h"
+#include "../memory/pointers.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned int threads)
+{
+    if (threads == 0)
+    {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        threads = std::max(1u, hardware > 1 ? hardware - 1 : 1u);
+    }
+
+    for (unsigned int i = 0; i < threads; ++i)
+    {
+        m_workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_jobAvailable.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::workerLoop()
+{
+    while (true)
+    {
+        Job job;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobAvailable.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+
+            if (m_stopping && m_jobs.empty())
+            {
+                return;
+            }
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            m_running++;
+        }
+
+        job();
+
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            m_running--;
+            if (m_running == 0 && m_jobs.empty())
+            {
+                m_idle.notify_all();
+            }
+        }
+    }
+}
+
+void ThreadPool::submit(Job job)
+{
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(std::move(job));
+    }
+    m_jobAvailable.notify_one();
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    grain = std::max<size_t>(1, grain);
+    size_t pieces = (count + grain - 1) / grain;
+
+    // Small ranges aren't worth waking anyone up for
+    if (pieces == 1)
+    {
+        fn(0, count);
+        return;
+    }
+
+    // Helpers can be dequeued after this call has returned, so what they share lives on the heap.
+    // fn and the range are only touched by helpers counted in active, which the caller waits for
+    struct Shared
+    {
+        std::atomic<size_t> next { 0 };
+        size_t active = 0;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+
+    auto shared = MakeShared<Shared>();
+    const auto* work = &fn;
+
+    auto runPieces = [shared, work, count, grain, pieces]()
+    {
+        size_t piece;
+        while ((piece = shared->next.fetch_add(1)) < pieces)
+        {
+            size_t begin = piece * grain;
+            (*work)(begin, std::min(count, begin + grain));
+        }
+    };
+
+    // Helpers go to the front of the queue so the caller isn't stuck behind jobs queued before
+    // it. One that only starts once every piece is taken returns without touching anything
+    size_t helpers = std::min(m_workers.size(), pieces - 1);
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < helpers; ++i)
+        {
+            m_jobs.push_front([shared, runPieces, pieces]()
+            {
+                {
+                    const std::lock_guard<std::mutex> lock(shared->mutex);
+                    if (shared->next.load() >= pieces)
+                    {
+                        return;
+                    }
+                    shared->active++;
+                }
+
+                runPieces();
+
+                const std::lock_guard<std::mutex> lock(shared->mutex);
+                shared->active--;
+                shared->done.notify_all();
+            });
+        }
+    }
+    m_jobAvailable.notify_all();
+
+    runPieces();
+
+    // Every piece has been claimed, only helpers still working on one need waiting for
+    std::unique_lock<std::mutex> lock(shared->mutex);
+    shared->done.wait(lock, [&] { return shared->active == 0; });
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this] { return m_jobs.empty() && m_running == 0; });
+}
+
+size_t ThreadPool::getQueueDepth()
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    return m_jobs.size();
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+// Fixed set of worker threads pulling jobs off a shared queue
+class ThreadPool
+{
+public:
+    using Job = std::function<void()>;
+
+private:
+    std::vector<std::thread> m_workers;
+    std::deque<Job> m_jobs;
+
+    std::mutex m_mutex;
+    std::condition_variable m_jobAvailable;
+    std::condition_variable m_idle;
+
+    size_t m_running = 0;
+    bool m_stopping = false;
+
+    void workerLoop();
+
+public:
+    // 0 threads uses one less than the hardware has, leaving room for the calling thread
+    ThreadPool(unsigned int threads = 0);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool& other) = delete;
+
+    ThreadPool& operator=(const ThreadPool& other) = delete;
+
+    void submit(Job job);
+
+    // Calls fn(begin, end) over [0, count) in pieces of at most grain, the calling
+    // thread works along and the call returns once every piece is done.
+    // Don't call it from inside a job of the same pool
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn);
+
+    // Blocks until the queue is empty and no job is running
+    void wait();
+
+    size_t getThreadCount() const
+    {
+        return m_workers.size();
+    }
+
+    size_t getQueueDepth();
+};
@@ -0,0 +1,92 @@
+#include "autosave.h"
+#include <algorithm>
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+Autosave::Autosave(RegionStorage& storage, double intervalSeconds)
+    : m_storage(storage), m_intervalSeconds(intervalSeconds), m_lastSave(Clock::now())
+{
+}
+
+void Autosave::update(World& world)
+{
+    // Chunks are marked saved as their snapshot is taken, so a failed write has to undo that or
+    // the chunk would be skipped until its next edit. One unloaded since has nothing to re-flag
+    m_stats.failed += m_storage.pollFailedSaves([&](int chunkX, int chunkZ)
+    {
+        if (Chunk* chunk = world.getChunk(chunkX, chunkZ))
+        {
+            chunk->markModified();
+        }
+    });
+
+    if (m_stats.saving)
+    {
+        if (m_storage.getStats().snapshots != 0)
+        {
+            return;
+        }
+
+        // Unloading chunks mid save takes their counters with them, so this can only undercount
+        size_t copied = getCopiedBytes(world);
+        m_stats.bytesCopied = copied > m_copiedBefore ? copied - m_copiedBefore : 0;
+        m_stats.durationMs = elapsedMs(m_saveStart);
+        m_stats.saving = false;
+        return;
+    }
+
+    if (std::chrono::duration<double>(Clock::now() - m_lastSave).count() >= m_intervalSeconds)
+    {
+        save(world);
+    }
+}
+
+bool Autosave::save(World& world)
+{
+    if (m_stats.saving)
+    {
+        return false;
+    }
+
+    auto start = Clock::now();
+    size_t chunks = 0;
+    size_t copied = 0;
+
+    world.forEachChunk([&](Chunk& chunk)
+    {
+        copied += chunk.getCopiedBytes();
+
+        if (!chunk.isModified())
+        {
+            return;
+        }
+
+        auto snapshot = MakeScoped<Chunk::Snapshot>();
+        chunk.takeSnapshot(*snapshot);
+        chunk.markSaved();
+        m_storage.save(std::move(snapshot));
+        ++chunks;
+    });
+
+    m_saveStart = m_lastSave = start;
+    m_copiedBefore = copied;
+
+    m_stats.saves++;
+    m_stats.saving = true;
+    m_stats.chunks = chunks;
+    m_stats.bytesCopied = 0;
+    m_stats.durationMs = 0.0;
+    m_stats.pauseMs = elapsedMs(start);
+    m_stats.maxPauseMs = std::max(m_stats.maxPauseMs, m_stats.pauseMs);
+    return true;
+}
+
+size_t Autosave::getCopiedBytes(const World& world)
+{
+    size_t copied = 0;
+    world.forEachChunk([&](const Chunk& chunk) { copied += chunk.getCopiedBytes(); });
+    return copied;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include "world.h"
+#include "regionstorage.h"
+
+// Periodically saves every modified chunk without holding up the tick. The tick thread only takes
+// snapshots, which share section storage with the live chunks, serializing, compressing and
+// writing happen on the storage I/O thread. Sections the game writes to before their snapshot
+// has been serialized are copied, everything else is never copied at all
+class Autosave
+{
+public:
+    struct Stats
+    {
+        size_t saves = 0;
+        bool saving = false;
+
+        // Of the most recent save
+        size_t chunks = 0;
+
+        // Tick thread time spent taking snapshots
+        double pauseMs = 0.0;
+        double maxPauseMs = 0.0;
+
+        // Section copies forced by writes while the save was running
+        size_t bytesCopied = 0;
+
+        // From taking the snapshots until the last one was written, only set once finished
+        double durationMs = 0.0;
+
+        // Chunks whose write failed, they're marked modified again for the next save
+        size_t failed = 0;
+    };
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    RegionStorage& m_storage;
+    double m_intervalSeconds;
+
+    Clock::time_point m_lastSave;
+    Clock::time_point m_saveStart;
+    size_t m_copiedBefore = 0;
+
+    Stats m_stats;
+
+    static size_t getCopiedBytes(const World& world);
+
+public:
+    Autosave(RegionStorage& storage, double intervalSeconds = 300.0);
+
+    // Call once a tick. Starts a save when the interval has passed, finishes the bookkeeping of
+    // the running one once all its snapshots are on disk and re-flags chunks that failed to write
+    void update(World& world);
+
+    // Starts a save right away, returns false if the previous one is still running
+    bool save(World& world);
+
+    bool isSaving() const { return m_stats.saving; }
+
+    const Stats& getStats() const { return m_stats; }
+};
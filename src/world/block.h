@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstdint>
+
+// Blocks are stored as dense numeric IDs, 0 is always air
+using BlockId = uint16_t;
+
+constexpr BlockId BLOCK_AIR = 0;
@@ -0,0 +1,161 @@
+#include "blockregistry.h"
+#include <iostream>
+
+static constexpr size_t INITIAL_SLOTS = 64;
+
+BlockRegistry::BlockRegistry()
+{
+    m_slots.resize(INITIAL_SLOTS);
+    m_mask = INITIAL_SLOTS - 1;
+
+    Definition air;
+    air.name = "air";
+    air.hardness = 0.0f;
+    air.solid = false;
+    air.opaque = false;
+    air.lightOpacity = 0;
+    add(air);
+}
+
+uint32_t BlockRegistry::hashName(std::string_view name)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (char c : name)
+    {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    return hash | 0x80000000u;
+}
+
+void BlockRegistry::insertSlot(Slot slot)
+{
+    uint32_t index = slot.hash & m_mask;
+    uint32_t distance = 0;
+
+    // Whichever entry is closer to its home slot moves on, which keeps probe lengths even
+    for (;;)
+    {
+        Slot& current = m_slots[index];
+        if (current.hash == 0)
+        {
+            current = slot;
+            return;
+        }
+
+        uint32_t currentDistance = (index - current.hash) & m_mask;
+        if (currentDistance < distance)
+        {
+            std::swap(current, slot);
+            distance = currentDistance;
+        }
+
+        index = (index + 1) & m_mask;
+        distance++;
+    }
+}
+
+void BlockRegistry::grow()
+{
+    std::vector<Slot> old = std::move(m_slots);
+    m_slots.assign(old.size() * 2, Slot());
+    m_mask = static_cast<uint32_t>(m_slots.size() - 1);
+
+    for (const Slot& slot : old)
+    {
+        if (slot.hash != 0)
+        {
+            insertSlot(slot);
+        }
+    }
+}
+
+BlockId BlockRegistry::add(const Definition& definition)
+{
+    BlockId existing;
+    if (find(definition.name, existing))
+    {
+        std::cout << "[ERROR] Block '" << definition.name << "' is already registered\n";
+        return BLOCK_AIR;
+    }
+
+    if (m_names.size() >= MAX_BLOCKS)
+    {
+        std::cout << "[ERROR] Can't register block '" << definition.name << "', all " << MAX_BLOCKS << " IDs are taken\n";
+        return BLOCK_AIR;
+    }
+
+    BlockId id = static_cast<BlockId>(m_names.size());
+
+    m_names.push_back(definition.name);
+    m_hardness.push_back(definition.hardness);
+    m_lightOpacity.push_back(definition.lightOpacity);
+    m_lightEmission.push_back(definition.lightEmission);
+    m_passes.push_back(static_cast<uint8_t>(definition.pass));
+    m_textures.insert(m_textures.end(), std::begin(definition.textures), std::end(definition.textures));
+
+    if ((id & 63) == 0)
+    {
+        m_solidBits.push_back(0);
+        m_opaqueBits.push_back(0);
+    }
+    m_solidBits.back() |= static_cast<uint64_t>(definition.solid) << (id & 63);
+    m_opaqueBits.back() |= static_cast<uint64_t>(definition.opaque) << (id & 63);
+
+    if (m_names.size() * 2 > m_slots.size())
+    {
+        grow();
+    }
+    insertSlot({ hashName(definition.name), id });
+
+    return id;
+}
+
+bool BlockRegistry::find(std::string_view name, BlockId& id) const
+{
+    uint32_t hash = hashName(name);
+    uint32_t index = hash & m_mask;
+
+    for (uint32_t distance = 0;; ++distance)
+    {
+        const Slot& slot = m_slots[index];
+
+        // Past where robin hood insertion would have put it
+        if (slot.hash == 0 || ((index - slot.hash) & m_mask) < distance)
+        {
+            return false;
+        }
+
+        if (slot.hash == hash && m_names[slot.id] == name)
+        {
+            id = slot.id;
+            return true;
+        }
+
+        index = (index + 1) & m_mask;
+    }
+}
+
+std::vector<BlockModel> BlockRegistry::createModels() const
+{
+    std::vector<BlockModel> models(getCount());
+    for (size_t id = 0; id < models.size(); ++id)
+    {
+        BlockModel& model = models[id];
+        std::copy_n(&m_textures[id * FACE_COUNT], FACE_COUNT, model.textures);
+        model.opaque = isOpaque(static_cast<BlockId>(id));
+        model.pass = getRenderPass(static_cast<BlockId>(id));
+    }
+    return models;
+}
+
+std::vector<LightProperties> BlockRegistry::createLightProperties() const
+{
+    std::vector<LightProperties> properties(getCount());
+    for (size_t id = 0; id < properties.size(); ++id)
+    {
+        properties[id].emission = m_lightEmission[id];
+        properties[id].opacity = m_lightOpacity[id];
+    }
+    return properties;
+}
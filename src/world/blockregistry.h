@@ -0,0 +1,128 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <cstdint>
+#include "block.h"
+#include "chunkmesher.h"
+#include "lightengine.h"
+
+// Every block type the game knows about. Blocks get dense IDs in the order they're added, air is
+// always 0, and each property lives in its own flat array indexed by ID so meshing, lighting and
+// physics only ever read a few bytes per block. Names are only for loading and scripts, they go
+// through a robin hood hash table once and the ID is used from then on.
+//
+// Add every block while loading, then only read. Reading is safe from any number of threads
+class BlockRegistry
+{
+public:
+    struct Definition
+    {
+        std::string name;
+
+        // Seconds to break by hand, negative for unbreakable
+        float hardness = 1.0f;
+
+        // Entities collide with it
+        bool solid = true;
+
+        // Hides the faces of anything next to it
+        bool opaque = true;
+
+        // Light lost passing into the block, 15 stops it completely
+        uint8_t lightOpacity = 15;
+        uint8_t lightEmission = 0;
+
+        RenderPass pass = RENDER_OPAQUE;
+
+        // Texture array layer for each BlockFace
+        uint16_t textures[FACE_COUNT] = {};
+
+        // Same layer on every face
+        void setTexture(uint16_t texture)
+        {
+            std::fill(std::begin(textures), std::end(textures), texture);
+        }
+    };
+
+    static constexpr size_t MAX_BLOCKS = 0x10000;
+
+private:
+    struct Slot
+    {
+        // 0 marks an empty slot, real hashes have the top bit set
+        uint32_t hash = 0;
+        BlockId id = BLOCK_AIR;
+    };
+
+    std::vector<std::string> m_names;
+    std::vector<float> m_hardness;
+    std::vector<uint8_t> m_lightOpacity;
+    std::vector<uint8_t> m_lightEmission;
+    std::vector<uint8_t> m_passes;
+    std::vector<uint16_t> m_textures;
+
+    // One bit per block
+    std::vector<uint64_t> m_solidBits;
+    std::vector<uint64_t> m_opaqueBits;
+
+    // Open addressing, a power of two in size and never more than half full
+    std::vector<Slot> m_slots;
+    uint32_t m_mask = 0;
+
+    static uint32_t hashName(std::string_view name);
+
+    static bool testBit(const std::vector<uint64_t>& bits, BlockId id)
+    {
+        return (bits[id >> 6] >> (id & 63)) & 1;
+    }
+
+    void insertSlot(Slot slot);
+
+    void grow();
+
+public:
+    // Starts out with only air
+    BlockRegistry();
+
+    // Returns the new block's ID. A name that's already taken, or a full registry, gets an error
+    // and BLOCK_AIR back
+    BlockId add(const Definition& definition);
+
+    // False if there's no block called name
+    bool find(std::string_view name, BlockId& id) const;
+
+    size_t getCount() const { return m_names.size(); }
+
+    // These expect an ID this registry handed out
+
+    const std::string& getName(BlockId id) const { return m_names[id]; }
+
+    float getHardness(BlockId id) const { return m_hardness[id]; }
+
+    bool isSolid(BlockId id) const { return testBit(m_solidBits, id); }
+
+    bool isOpaque(BlockId id) const { return testBit(m_opaqueBits, id); }
+
+    uint8_t getLightOpacity(BlockId id) const { return m_lightOpacity[id]; }
+
+    uint8_t getLightEmission(BlockId id) const { return m_lightEmission[id]; }
+
+    RenderPass getRenderPass(BlockId id) const { return static_cast<RenderPass>(m_passes[id]); }
+
+    uint16_t getTexture(BlockId id, BlockFace face) const { return m_textures[id * FACE_COUNT + face]; }
+
+    // The whole arrays, for code that wants to index them directly
+    const float* getHardnessData() const { return m_hardness.data(); }
+    const uint8_t* getLightOpacityData() const { return m_lightOpacity.data(); }
+    const uint8_t* getLightEmissionData() const { return m_lightEmission.data(); }
+    const uint64_t* getSolidBits() const { return m_solidBits.data(); }
+    const uint64_t* getOpaqueBits() const { return m_opaqueBits.data(); }
+
+    // Tables for the systems that take their own, indexed by BlockId
+    std::vector<BlockModel> createModels() const;
+    std::vector<LightProperties> createLightProperties() const;
+};
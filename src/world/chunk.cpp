@@ -0,0 +1,191 @@
+#include "chunk.h"
+#include "../io/bytebuffer.h"
+#include <algorithm>
+#include <atomic>
+
+// Bumped whenever the payload layout changes
+static constexpr uint16_t CHUNK_FORMAT_VERSION = 1;
+
+namespace
+{
+    // Shared by Chunk and Snapshot, which only differ in the constness of their section pointers
+    template<typename Sections>
+    void serializeChunk(std::vector<uint8_t>& out, int chunkX, int chunkZ, const Sections& sections, const uint16_t* heightmap)
+    {
+        ByteWriter writer(out);
+
+        writer.write(CHUNK_FORMAT_VERSION);
+        writer.write(static_cast<int32_t>(chunkX));
+        writer.write(static_cast<int32_t>(chunkZ));
+        writer.write(static_cast<uint8_t>(Chunk::SECTION_COUNT));
+
+        for (const auto& section : sections)
+        {
+            section->blocks.serialize(writer);
+            section->skyLight.serialize(writer);
+            section->blockLight.serialize(writer);
+        }
+
+        writer.writeBytes(heightmap, Chunk::SIZE * Chunk::SIZE * sizeof(uint16_t));
+    }
+}
+
+Chunk::Chunk(int x, int z) : m_x(x), m_z(z)
+{
+    for (SharedPtr<SectionData>& section : m_sections)
+    {
+        section = MakeShared<SectionData>();
+    }
+}
+
+Chunk::SectionData& Chunk::writeSection(int index)
+{
+    SharedPtr<SectionData>& section = m_sections[index];
+
+    if (section.use_count() > 1)
+    {
+        section = MakeShared<SectionData>(*section);
+        m_copiedBytes += section->getMemoryUsage();
+    }
+    else
+    {
+        // The saving thread may have only just dropped its reference, its reads have to be
+        // ordered before the writes we're about to make
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+
+    m_modified = true;
+    return *section;
+}
+
+BlockId Chunk::getBlock(int x, int y, int z) const
+{
+    if ((x | z) & ~(SIZE - 1) || y < 0 || y >= HEIGHT)
+    {
+        return BLOCK_AIR;
+    }
+
+    return m_sections[y >> 4]->blocks.getBlock(x, y & 15, z);
+}
+
+BlockId Chunk::setBlock(int x, int y, int z, BlockId block)
+{
+    if ((x | z) & ~(SIZE - 1) || y < 0 || y >= HEIGHT)
+    {
+        return BLOCK_AIR;
+    }
+
+    // Reading first keeps no-op writes from copying a shared section
+    int sectionY = y >> 4;
+    if (m_sections[sectionY]->blocks.getBlock(x, y & 15, z) == block)
+    {
+        return block;
+    }
+
+    return writeSection(sectionY).blocks.setBlock(x, y & 15, z, block);
+}
+
+void Chunk::compact()
+{
+    for (SharedPtr<SectionData>& section : m_sections)
+    {
+        if (section.use_count() == 1)
+        {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            section->blocks.compact();
+        }
+    }
+}
+
+void Chunk::takeSnapshot(Snapshot& snapshot) const
+{
+    snapshot.x = m_x;
+    snapshot.z = m_z;
+
+    for (int i = 0; i < SECTION_COUNT; ++i)
+    {
+        snapshot.sections[i] = m_sections[i];
+    }
+
+    std::copy(std::begin(m_heightmap), std::end(m_heightmap), snapshot.heightmap);
+}
+
+Chunk::MemoryStats Chunk::getMemoryStats() const
+{
+    MemoryStats stats;
+    stats.bytes = sizeof(Chunk);
+
+    for (int i = 0; i < SECTION_COUNT; ++i)
+    {
+        const SectionData& data = *m_sections[i];
+        const ChunkSection& section = data.blocks;
+        stats.bytes += data.getMemoryUsage();
+        stats.litSections += !data.skyLight.isUniform() + !data.blockLight.isUniform();
+
+        if (section.isUniform())
+        {
+            ++stats.uniformSections;
+            stats.emptySections += section.isEmpty();
+        }
+        else if (section.getBitsPerBlock() == 16)
+        {
+            ++stats.directSections;
+        }
+        else
+        {
+            ++stats.paletteSections;
+        }
+    }
+
+    return stats;
+}
+
+void Chunk::serialize(std::vector<uint8_t>& out) const
+{
+    serializeChunk(out, m_x, m_z, m_sections, m_heightmap);
+}
+
+void Chunk::Snapshot::serialize(std::vector<uint8_t>& out) const
+{
+    serializeChunk(out, x, z, sections, heightmap);
+}
+
+bool Chunk::deserialize(const uint8_t* data, size_t size)
+{
+    ByteReader reader(data, size);
+
+    uint16_t version = reader.read<uint16_t>();
+    int x = reader.read<int32_t>();
+    int z = reader.read<int32_t>();
+    int sectionCount = reader.read<uint8_t>();
+
+    if (reader.hasFailed() || version != CHUNK_FORMAT_VERSION || x != m_x || z != m_z || sectionCount != SECTION_COUNT)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < SECTION_COUNT; ++i)
+    {
+        // Fresh storage rather than writeSection, a snapshot of the old contents keeps its own
+        SharedPtr<SectionData> section = MakeShared<SectionData>();
+        m_sections[i] = section;
+
+        if (!section->blocks.deserialize(reader))
+        {
+            return false;
+        }
+
+        section->skyLight.deserialize(reader);
+        section->blockLight.deserialize(reader);
+    }
+
+    reader.readBytes(m_heightmap, sizeof(m_heightmap));
+    if (reader.hasFailed())
+    {
+        return false;
+    }
+
+    // Freshly loaded, nothing to save until it changes
+    m_modified = false;
+    return true;
+}
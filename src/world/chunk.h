@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "block.h"
+#include "chunksection.h"
+#include "nibblearray.h"
+#include "../memory/pointers.h"
+
+// A vertical column of sections, 16 blocks wide and SECTION_COUNT sections tall.
+// Section storage is shared with snapshots taken for saving, writing to a section a snapshot
+// still references copies it first so the snapshot never changes under the thread saving it
+class Chunk
+{
+public:
+    static constexpr int SIZE = ChunkSection::SIZE;
+    static constexpr int SECTION_COUNT = 16;
+    static constexpr int HEIGHT = SIZE * SECTION_COUNT;
+
+    struct MemoryStats
+    {
+        size_t bytes = 0;
+        int uniformSections = 0;
+        int emptySections = 0;
+        int paletteSections = 0;
+        int directSections = 0;
+
+        // Light sections that needed their own storage
+        int litSections = 0;
+    };
+
+    struct SectionData
+    {
+        ChunkSection blocks;
+        NibbleArray skyLight;
+        NibbleArray blockLight;
+
+        size_t getMemoryUsage() const
+        {
+            return blocks.getMemoryUsage() + skyLight.getMemoryUsage() + blockLight.getMemoryUsage();
+        }
+    };
+
+    // The chunk as it was when the snapshot was taken, can be serialized on any thread
+    struct Snapshot
+    {
+        int x = 0;
+        int z = 0;
+        SharedPtr<const SectionData> sections[SECTION_COUNT];
+        uint16_t heightmap[SIZE * SIZE] = {};
+
+        void serialize(std::vector<uint8_t>& out) const;
+    };
+
+private:
+    int m_x;
+    int m_z;
+
+    SharedPtr<SectionData> m_sections[SECTION_COUNT];
+
+    // One above the highest block in each column that dims sky light, 0 for an open column
+    uint16_t m_heightmap[SIZE * SIZE] = {};
+
+    // Changed since the last save, new chunks start out unsaved
+    bool m_modified = true;
+
+    // Bytes copied because a section was written while a snapshot shared it
+    size_t m_copiedBytes = 0;
+
+    // Every write goes through here so shared sections get copied first
+    SectionData& writeSection(int index);
+
+public:
+    Chunk(int x, int z);
+
+    int getX() const { return m_x; }
+    int getZ() const { return m_z; }
+
+    // Local block coordinates, x and z in [0, SIZE), y in [0, HEIGHT). Out of range reads return air
+    BlockId getBlock(int x, int y, int z) const;
+
+    // Returns the block that was replaced, out of range writes are ignored
+    BlockId setBlock(int x, int y, int z, BlockId block);
+
+    const ChunkSection& getSection(int index) const { return m_sections[index]->blocks; }
+
+    // Light levels 0-15. Above the world is full sky light, below it is dark
+    uint8_t getSkyLight(int x, int y, int z) const
+    {
+        if (y >= HEIGHT)
+        {
+            return 15;
+        }
+        return y < 0 ? 0 : m_sections[y >> 4]->skyLight.get(x, y & 15, z);
+    }
+
+    uint8_t getBlockLight(int x, int y, int z) const
+    {
+        return y < 0 || y >= HEIGHT ? 0 : m_sections[y >> 4]->blockLight.get(x, y & 15, z);
+    }
+
+    void setSkyLight(int x, int y, int z, uint8_t level) { writeSection(y >> 4).skyLight.set(x, y & 15, z, level); }
+
+    void setBlockLight(int x, int y, int z, uint8_t level) { writeSection(y >> 4).blockLight.set(x, y & 15, z, level); }
+
+    NibbleArray& getSkyLightSection(int index) { return writeSection(index).skyLight; }
+    NibbleArray& getBlockLightSection(int index) { return writeSection(index).blockLight; }
+
+    int getHeight(int x, int z) const { return m_heightmap[(z << 4) | x]; }
+
+    void setHeight(int x, int z, int height)
+    {
+        m_heightmap[(z << 4) | x] = static_cast<uint16_t>(height);
+        m_modified = true;
+    }
+
+    // Sections a snapshot still references are left for a later call
+    void compact();
+
+    // Shares the current sections, only the heightmap is copied
+    void takeSnapshot(Snapshot& snapshot) const;
+
+    bool isModified() const { return m_modified; }
+
+    void markSaved() { m_modified = false; }
+
+    // For a save that didn't make it to disk after all
+    void markModified() { m_modified = true; }
+
+    size_t getCopiedBytes() const { return m_copiedBytes; }
+
+    // Appends blocks, light and heightmap in the region file payload format
+    void serialize(std::vector<uint8_t>& out) const;
+
+    // Returns false if the data is malformed, the chunk is then left partly filled
+    bool deserialize(const uint8_t* data, size_t size);
+
+    MemoryStats getMemoryStats() const;
+
+    size_t getMemoryUsage() const { return getMemoryStats().bytes; }
+};
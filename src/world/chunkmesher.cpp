@@ -0,0 +1,500 @@
+#include "chunkmesher.h"
+#include "world.h"
+#include "../graphics/bufferbuilder.h"
+#include <glad/glad.h>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+
+using Clock = std::chrono::high_resolution_clock;
+
+static double elapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Merge key layout: texture 16 | ao 4x2 | light 4x8 | pass 2 | ... | present
+static constexpr uint64_t FACE_PRESENT = 1ull << 63;
+static constexpr int KEY_AO_SHIFT = 16;
+static constexpr int KEY_LIGHT_SHIFT = 24;
+static constexpr int KEY_PASS_SHIFT = 56;
+
+// Quad corners in (u, v), the same order vertices are emitted in
+static const int CORNERS[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+
+ChunkMesher::ChunkMesher(const std::vector<BlockModel>& models)
+    : m_models(models.data()), m_modelCount(models.size())
+{
+}
+
+const BlockModel& ChunkMesher::getModel(BlockId block) const
+{
+    static const BlockModel unknown;
+    return block < m_modelCount ? m_models[block] : unknown;
+}
+
+bool ChunkMesher::isFaceVisible(BlockId block, BlockId neighbour) const
+{
+    if (neighbour == BLOCK_AIR)
+    {
+        return true;
+    }
+
+    // Glass next to glass hides the face between them, glass next to water doesn't
+    return !getModel(neighbour).opaque && neighbour != block;
+}
+
+void ChunkMesher::takeSnapshot(const World& world, int chunkX, int sectionY, int chunkZ, Snapshot& snapshot)
+{
+    snapshot.chunkX = chunkX;
+    snapshot.sectionY = sectionY;
+    snapshot.chunkZ = chunkZ;
+    snapshot.empty = true;
+
+    const Chunk* centre = world.getChunk(chunkX, chunkZ);
+    if (!centre || sectionY < 0 || sectionY >= Chunk::SECTION_COUNT || centre->getSection(sectionY).isEmpty())
+    {
+        return;
+    }
+
+    const Chunk* chunks[3][3];
+    for (int dz = -1; dz <= 1; ++dz)
+    {
+        for (int dx = -1; dx <= 1; ++dx)
+        {
+            chunks[dz + 1][dx + 1] = world.getChunk(chunkX + dx, chunkZ + dz);
+        }
+    }
+
+    int baseY = sectionY * SIZE;
+    BlockId* out = snapshot.blocks;
+    uint8_t* light = snapshot.light;
+
+    for (int y = -1; y <= SIZE; ++y)
+    {
+        for (int z = -1; z <= SIZE; ++z)
+        {
+            const Chunk* const* row = chunks[z < 0 ? 0 : (z < SIZE ? 1 : 2)];
+
+            for (int x = -1; x <= SIZE; ++x)
+            {
+                const Chunk* chunk = row[x < 0 ? 0 : (x < SIZE ? 1 : 2)];
+                if (chunk)
+                {
+                    int lx = x & (SIZE - 1);
+                    int lz = z & (SIZE - 1);
+                    *out++ = chunk->getBlock(lx, baseY + y, lz);
+                    *light++ = static_cast<uint8_t>((chunk->getSkyLight(lx, baseY + y, lz) << 4) | chunk->getBlockLight(lx, baseY + y, lz));
+                }
+                else
+                {
+                    // Unloaded neighbours read as open sky so borders don't show dark seams
+                    *out++ = BLOCK_AIR;
+                    *light++ = 0xF0;
+                }
+            }
+        }
+    }
+
+    snapshot.empty = false;
+}
+
+void ChunkMesher::buildOpaqueRows(const Snapshot& snapshot)
+{
+    std::memset(m_opaqueX, 0, sizeof(m_opaqueX));
+    std::memset(m_opaqueZ, 0, sizeof(m_opaqueZ));
+
+    const BlockId* block = snapshot.blocks;
+
+    for (int y = 0; y < PADDED; ++y)
+    {
+        for (int z = 0; z < PADDED; ++z)
+        {
+            for (int x = 0; x < PADDED; ++x, ++block)
+            {
+                if (*block != BLOCK_AIR && getModel(*block).opaque)
+                {
+                    m_opaqueX[y * PADDED + z] |= 1u << x;
+                    m_opaqueZ[y * PADDED + x] |= 1u << z;
+                }
+            }
+        }
+    }
+}
+
+uint16_t ChunkMesher::computeConnectivity()
+{
+    // One bit per block of the section, opaque blocks start out as already visited
+    uint64_t visited[ChunkSection::VOLUME / 64];
+
+    bool open = false;
+    for (int y = 0; y < SIZE; ++y)
+    {
+        for (int z = 0; z < SIZE; ++z)
+        {
+            uint64_t row = (m_opaqueX[(y + 1) * PADDED + z + 1] >> 1) & 0xFFFF;
+            int index = (y << 8) | (z << 4);
+
+            if ((z & 3) == 0)
+            {
+                visited[index >> 6] = 0;
+            }
+
+            visited[index >> 6] |= row << (index & 63);
+            open |= row != 0xFFFF;
+        }
+    }
+
+    if (!open)
+    {
+        return 0;
+    }
+
+    uint16_t connectivity = 0;
+
+    for (int start = 0; start < ChunkSection::VOLUME; ++start)
+    {
+        if ((visited[start >> 6] >> (start & 63)) & 1)
+        {
+            continue;
+        }
+
+        visited[start >> 6] |= 1ull << (start & 63);
+        m_floodStack.assign(1, static_cast<uint16_t>(start));
+
+        int faces = 0;
+
+        while (!m_floodStack.empty())
+        {
+            int index = m_floodStack.back();
+            m_floodStack.pop_back();
+
+            int x = index & 15;
+            int z = (index >> 4) & 15;
+            int y = index >> 8;
+
+            faces |= (y == 0) << FACE_DOWN | (y == SIZE - 1) << FACE_UP
+                | (z == 0) << FACE_NORTH | (z == SIZE - 1) << FACE_SOUTH
+                | (x == 0) << FACE_WEST | (x == SIZE - 1) << FACE_EAST;
+
+            const int neighbours[6] = {
+                y > 0 ? index - 256 : -1, y < SIZE - 1 ? index + 256 : -1,
+                z > 0 ? index - 16 : -1, z < SIZE - 1 ? index + 16 : -1,
+                x > 0 ? index - 1 : -1, x < SIZE - 1 ? index + 1 : -1
+            };
+
+            for (int next : neighbours)
+            {
+                if (next >= 0 && !((visited[next >> 6] >> (next & 63)) & 1))
+                {
+                    visited[next >> 6] |= 1ull << (next & 63);
+                    m_floodStack.push_back(static_cast<uint16_t>(next));
+                }
+            }
+        }
+
+        for (int a = 0; a < FACE_COUNT; ++a)
+        {
+            for (int b = a + 1; b < FACE_COUNT; ++b)
+            {
+                if ((faces >> a & 1) && (faces >> b & 1))
+                {
+                    connectivity |= 1 << getFacePairBit(a, b);
+                }
+            }
+        }
+
+        if (connectivity == ALL_FACES_CONNECTED)
+        {
+            break;
+        }
+    }
+
+    return connectivity;
+}
+
+void ChunkMesher::meshFace(const Snapshot& snapshot, int face, Mesh& mesh)
+{
+    static const int AXES[FACE_COUNT] = { 1, 1, 2, 2, 0, 0 };
+
+    // Horizontal texture axis first so side textures stay upright
+    static const int U_AXES[3] = { 2, 0, 0 };
+    static const int V_AXES[3] = { 1, 2, 1 };
+
+    // Sign of U x V along the face axis
+    static const int WINDING[3] = { -1, -1, 1 };
+
+    // Snapshot index step along x, y and z
+    static const int STRIDES[3] = { 1, PADDED * PADDED, PADDED };
+
+    const int d = AXES[face];
+    const int u = U_AXES[d];
+    const int v = V_AXES[d];
+    const bool positive = (face & 1) != 0;
+    const bool flip = positive != (WINDING[d] > 0);
+
+    int offset[3] = { 0, 0, 0 };
+    offset[d] = positive ? 1 : -1;
+
+    // Opaque bits of the layer in front of the faces, one row per v with bits along u
+    uint32_t rows[PADDED];
+
+    for (int slice = 0; slice < SIZE; ++slice)
+    {
+        const int layer = slice + offset[d] + 1;
+
+        for (int j = 0; j < PADDED; ++j)
+        {
+            rows[j] = d == 0 ? m_opaqueZ[j * PADDED + layer] : (d == 1 ? m_opaqueX[layer * PADDED + j] : m_opaqueX[j * PADDED + layer]);
+        }
+
+        int p[3];
+        p[d] = slice;
+
+        for (int j = 0; j < SIZE; ++j)
+        {
+            // Ambient occlusion for every corner of the whole row at once, as two bit planes.
+            // Bit i is cell i, side1 is the neighbour along u, side2 along v, corner the diagonal
+            uint32_t aoLow[4];
+            uint32_t aoHigh[4];
+
+            if (m_smoothLighting)
+            {
+                for (int c = 0; c < 4; ++c)
+                {
+                    uint32_t row = rows[j + 1];
+                    uint32_t next = rows[j + 1 + CORNERS[c][1]];
+
+                    uint32_t side1 = CORNERS[c][0] < 0 ? row : row >> 2;
+                    uint32_t side2 = next >> 1;
+                    uint32_t corner = CORNERS[c][0] < 0 ? next : next >> 2;
+
+                    // 3 - (side1 + side2 + corner), or 0 when both sides are blocked
+                    uint32_t blocked = side1 & side2;
+                    aoLow[c] = ~(side1 ^ side2 ^ corner) & ~blocked;
+                    aoHigh[c] = ~(blocked | (corner & (side1 ^ side2)));
+                }
+            }
+
+            p[v] = j;
+            for (int i = 0; i < SIZE; ++i)
+            {
+                p[u] = i;
+
+                uint64_t& key = m_mask[j * SIZE + i];
+                key = 0;
+
+                BlockId block = snapshot.get(p[0], p[1], p[2]);
+                if (block == BLOCK_AIR)
+                {
+                    continue;
+                }
+
+                int front = Snapshot::index(p[0] + offset[0], p[1] + offset[1], p[2] + offset[2]);
+                if (!isFaceVisible(block, snapshot.blocks[front]))
+                {
+                    continue;
+                }
+
+                ++m_stats.visibleFaces;
+
+                const BlockModel& model = getModel(block);
+                key = FACE_PRESENT | model.textures[face] | (static_cast<uint64_t>(model.pass) << KEY_PASS_SHIFT);
+
+                if (!m_smoothLighting)
+                {
+                    uint64_t light = snapshot.light[front];
+                    key |= 0xFFull << KEY_AO_SHIFT;
+                    key |= (light | (light << 8) | (light << 16) | (light << 24)) << KEY_LIGHT_SHIFT;
+                    continue;
+                }
+
+                for (int c = 0; c < 4; ++c)
+                {
+                    const int du = CORNERS[c][0];
+                    const int dv = CORNERS[c][1];
+
+                    uint64_t ao = (((aoHigh[c] >> i) & 1) << 1) | ((aoLow[c] >> i) & 1);
+
+                    // Average the light of the open blocks around the corner
+                    bool side1Open = !((rows[j + 1] >> (i + 1 + du)) & 1);
+                    bool side2Open = !((rows[j + 1 + dv] >> (i + 1)) & 1);
+                    bool cornerOpen = (side1Open || side2Open) && !((rows[j + 1 + dv] >> (i + 1 + du)) & 1);
+
+                    int sky = snapshot.light[front] >> 4;
+                    int blockLight = snapshot.light[front] & 15;
+                    int count = 1;
+
+                    const int samples[3] = { front + du * STRIDES[u], front + dv * STRIDES[v], front + du * STRIDES[u] + dv * STRIDES[v] };
+                    const bool open[3] = { side1Open, side2Open, cornerOpen };
+
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        if (open[k])
+                        {
+                            sky += snapshot.light[samples[k]] >> 4;
+                            blockLight += snapshot.light[samples[k]] & 15;
+                            ++count;
+                        }
+                    }
+
+                    uint64_t light = (((sky + count / 2) / count) << 4) | ((blockLight + count / 2) / count);
+
+                    key |= ao << (KEY_AO_SHIFT + c * 2);
+                    key |= light << (KEY_LIGHT_SHIFT + c * 8);
+                }
+            }
+        }
+
+        // Grow each face as wide as it goes, then as tall as the whole row still matches
+        for (int j = 0; j < SIZE; ++j)
+        {
+            for (int i = 0; i < SIZE;)
+            {
+                uint64_t key = m_mask[j * SIZE + i];
+                if (key == 0)
+                {
+                    ++i;
+                    continue;
+                }
+
+                int w = 1;
+                while (i + w < SIZE && m_mask[j * SIZE + i + w] == key)
+                {
+                    ++w;
+                }
+
+                int h = 1;
+                for (; j + h < SIZE; ++h)
+                {
+                    const uint64_t* row = &m_mask[(j + h) * SIZE + i];
+
+                    int k = 0;
+                    while (k < w && row[k] == key)
+                    {
+                        ++k;
+                    }
+
+                    if (k < w)
+                    {
+                        break;
+                    }
+                }
+
+                for (int dh = 0; dh < h; ++dh)
+                {
+                    std::memset(&m_mask[(j + dh) * SIZE + i], 0, w * sizeof(uint64_t));
+                }
+
+                const uint32_t layer = static_cast<uint32_t>(key & 0xFFFF);
+                std::vector<unsigned int>& indices = m_passIndices[(key >> KEY_PASS_SHIFT) & 3];
+                const unsigned int base = static_cast<unsigned int>(mesh.vertices.size());
+
+                int brightness[4];
+
+                for (int c = 0; c < 4; ++c)
+                {
+                    int cu = CORNERS[c][0] > 0 ? w : 0;
+                    int cv = CORNERS[c][1] > 0 ? h : 0;
+
+                    int pos[3];
+                    pos[d] = slice + (positive ? 1 : 0);
+                    pos[u] = i + cu;
+                    pos[v] = j + cv;
+
+                    uint32_t ao = static_cast<uint32_t>(key >> (KEY_AO_SHIFT + c * 2)) & 3;
+                    uint32_t light = static_cast<uint32_t>(key >> (KEY_LIGHT_SHIFT + c * 8)) & 0xFF;
+                    brightness[c] = ao * 32 + (light >> 4) + (light & 15);
+
+                    // Texture V runs down the side faces
+                    int texV = d == 1 ? cv : h - cv;
+
+                    PackedVertex vertex;
+                    vertex.position = pos[0] | (pos[1] << 5) | (pos[2] << 10) | (face << 15) | (ao << 18) | ((light >> 4) << 20) | ((light & 15) << 24);
+                    vertex.texture = layer | (cu << 16) | (texV << 24);
+                    mesh.vertices.push_back(vertex);
+                }
+
+                // Split along the brighter diagonal so a single dark corner shades evenly instead of in a streak
+                unsigned int a = base;
+                unsigned int b = base + 1;
+                unsigned int c = base + 2;
+                unsigned int e = base + 3;
+                if (brightness[0] + brightness[2] < brightness[1] + brightness[3])
+                {
+                    a = base + 1;
+                    b = base + 2;
+                    c = base + 3;
+                    e = base;
+                }
+
+                if (flip)
+                {
+                    indices.insert(indices.end(), { a, c, b, a, e, c });
+                }
+                else
+                {
+                    indices.insert(indices.end(), { a, b, c, a, c, e });
+                }
+
+                ++m_stats.quads;
+                i += w;
+            }
+        }
+    }
+}
+
+void ChunkMesher::mesh(const Snapshot& snapshot, Mesh& mesh)
+{
+    Clock::time_point start = Clock::now();
+
+    mesh.clear();
+    m_stats = Stats();
+    m_stats.smoothLighting = m_smoothLighting;
+
+    if (!snapshot.empty)
+    {
+        buildOpaqueRows(snapshot);
+
+        for (int y = 0; y < SIZE; ++y)
+        {
+            for (int z = 0; z < SIZE; ++z)
+            {
+                for (int x = 0; x < SIZE; ++x)
+                {
+                    m_stats.naiveVertices += snapshot.get(x, y, z) != BLOCK_AIR ? 24 : 0;
+                }
+            }
+        }
+
+        for (std::vector<unsigned int>& indices : m_passIndices)
+        {
+            indices.clear();
+        }
+
+        for (int face = 0; face < FACE_COUNT; ++face)
+        {
+            meshFace(snapshot, face, mesh);
+        }
+
+        for (int pass = 0; pass < RENDER_PASS_COUNT; ++pass)
+        {
+            mesh.indices.insert(mesh.indices.end(), m_passIndices[pass].begin(), m_passIndices[pass].end());
+            mesh.passIndexCounts[pass] = m_passIndices[pass].size();
+        }
+
+        mesh.connectivity = computeConnectivity();
+    }
+
+    m_stats.vertices = mesh.vertices.size();
+    m_stats.meshMs = elapsedMs(start);
+}
+
+void ChunkMesher::upload(const Mesh& mesh, BufferBuilder& builder)
+{
+    builder.setVertexData(mesh.vertices)
+        .setIndices(mesh.indices)
+        .addIntegerAttribute(0, 1, GL_UNSIGNED_INT, offsetof(PackedVertex, position))
+        .addIntegerAttribute(1, 1, GL_UNSIGNED_INT, offsetof(PackedVertex, texture))
+        .build();
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include "block.h"
+#include "chunk.h"
+
+class World;
+class BufferBuilder;
+
+enum BlockFace
+{
+    FACE_DOWN,  // -Y
+    FACE_UP,    // +Y
+    FACE_NORTH, // -Z
+    FACE_SOUTH, // +Z
+    FACE_WEST,  // -X
+    FACE_EAST,  // +X
+    FACE_COUNT
+};
+
+enum RenderPass
+{
+    RENDER_OPAQUE,
+    RENDER_CUTOUT,      // Alpha tested, like leaves
+    RENDER_TRANSLUCENT, // Blended, drawn last
+    RENDER_PASS_COUNT
+};
+
+// How the mesher draws a block, indexed by BlockId. Air is never drawn
+struct BlockModel
+{
+    // Texture array layer for each BlockFace
+    uint16_t textures[FACE_COUNT] = {};
+
+    // Hides the faces of anything next to it
+    bool opaque = true;
+
+    RenderPass pass = RENDER_OPAQUE;
+};
+
+// Turns one chunk section into quads. Faces touching an opaque block (or the same see-through
+// block) are dropped, and coplanar faces with the same texture are merged greedily into larger
+// rectangles. Not thread safe, use one mesher per thread
+class ChunkMesher
+{
+public:
+    static constexpr int SIZE = ChunkSection::SIZE;
+
+    // The section plus a one block border taken from its neighbours
+    static constexpr int PADDED = SIZE + 2;
+
+    // Two 32-bit words per vertex, read with BufferBuilder::addIntegerAttribute.
+    // position: x 5 | y 5 | z 5 | face 3 | ao 2 | sky light 4 | block light 4, positions relative to the section
+    // texture:  layer 16 | u 8 | v 8, UVs in blocks so merged quads repeat the texture
+    struct PackedVertex
+    {
+        uint32_t position;
+        uint32_t texture;
+    };
+
+    // Everything the mesher reads, copied out of the world so it can be meshed anywhere
+    struct Snapshot
+    {
+        int chunkX = 0;
+        int sectionY = 0;
+        int chunkZ = 0;
+
+        // Air and border-only sections have nothing to draw
+        bool empty = true;
+
+        BlockId blocks[PADDED * PADDED * PADDED];
+
+        // Sky light in the high nibble, block light in the low one
+        uint8_t light[PADDED * PADDED * PADDED];
+
+        // x, y and z range from -1 to SIZE
+        static int index(int x, int y, int z) { return ((y + 1) * PADDED + (z + 1)) * PADDED + (x + 1); }
+
+        BlockId get(int x, int y, int z) const { return blocks[index(x, y, z)]; }
+    };
+
+    // Bit per pair of BlockFaces, see getFacePairBit
+    static constexpr uint16_t ALL_FACES_CONNECTED = 0x7FFF;
+
+    struct Mesh
+    {
+        std::vector<PackedVertex> vertices;
+
+        // Grouped by RenderPass, opaque first
+        std::vector<unsigned int> indices;
+        size_t passIndexCounts[RENDER_PASS_COUNT] = {};
+
+        // Which pairs of the section's faces can see each other through non-opaque blocks
+        uint16_t connectivity = ALL_FACES_CONNECTED;
+
+        void clear()
+        {
+            vertices.clear();
+            indices.clear();
+            std::fill(passIndexCounts, passIndexCounts + RENDER_PASS_COUNT, size_t(0));
+            connectivity = ALL_FACES_CONNECTED;
+        }
+
+        bool isEmpty() const { return indices.empty(); }
+    };
+
+    struct Stats
+    {
+        // What one box per block (24 vertices each) would have cost
+        size_t naiveVertices = 0;
+        size_t visibleFaces = 0;
+        size_t quads = 0;
+        size_t vertices = 0;
+        double meshMs = 0.0;
+        bool smoothLighting = false;
+    };
+
+private:
+    const BlockModel* m_models;
+    size_t m_modelCount;
+
+    // One slice of faces, each entry a merge key (0 = no face). Faces only merge when texture,
+    // occlusion and light match at all four corners
+    uint64_t m_mask[SIZE * SIZE];
+
+    // Opaque blocks of the snapshot as bit rows, bit x + 1 of m_opaqueX[y][z] and bit z + 1 of
+    // m_opaqueZ[y][x], so a whole row's occlusion is worked out with a few shifts
+    uint32_t m_opaqueX[PADDED * PADDED];
+    uint32_t m_opaqueZ[PADDED * PADDED];
+
+    bool m_smoothLighting = true;
+
+    std::vector<unsigned int> m_passIndices[RENDER_PASS_COUNT];
+
+    std::vector<uint16_t> m_floodStack;
+
+    Stats m_stats;
+
+    void buildOpaqueRows(const Snapshot& snapshot);
+
+    // Flood fills the open blocks of the section and records which faces each open region touches
+    uint16_t computeConnectivity();
+
+    const BlockModel& getModel(BlockId block) const;
+
+    bool isFaceVisible(BlockId block, BlockId neighbour) const;
+
+    void meshFace(const Snapshot& snapshot, int face, Mesh& mesh);
+
+public:
+    ChunkMesher(const std::vector<BlockModel>& models);
+
+    // Copies a section and the blocks bordering it. Missing neighbour chunks read as air
+    static void takeSnapshot(const World& world, int chunkX, int sectionY, int chunkZ, Snapshot& snapshot);
+
+    void mesh(const Snapshot& snapshot, Mesh& mesh);
+
+    // Per-vertex ambient occlusion and light averaged over the four blocks touching each corner.
+    // Off gives flat light from the block in front of each face
+    void setSmoothLighting(bool smooth) { m_smoothLighting = smooth; }
+
+    bool getSmoothLighting() const { return m_smoothLighting; }
+
+    // Stats of the last mesh call
+    const Stats& getStats() const { return m_stats; }
+
+    static int getFacePairBit(int a, int b)
+    {
+        if (a > b)
+        {
+            std::swap(a, b);
+        }
+        return a * (11 - a) / 2 + (b - a - 1);
+    }
+
+    static bool isConnected(uint16_t connectivity, int a, int b)
+    {
+        return a != b && (connectivity >> getFacePairBit(a, b)) & 1;
+    }
+
+    // Uploads the mesh and describes the packed vertex layout, position at location 0 and texture at 1
+    static void upload(const Mesh& mesh, BufferBuilder& builder);
+};
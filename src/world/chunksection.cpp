@@ -0,0 +1,319 @@
+#include "chunksection.h"
+#include "../io/bytebuffer.h"
+#include <algorithm>
+
+namespace
+{
+    uint32_t readPacked(const std::vector<uint64_t>& data, int bits, int index)
+    {
+        // bits is always a power of two, so an index never straddles two words
+        size_t bit = static_cast<size_t>(index) * bits;
+        return static_cast<uint32_t>((data[bit >> 6] >> (bit & 63)) & ((1ull << bits) - 1));
+    }
+
+    void writePacked(std::vector<uint64_t>& data, int bits, int index, uint32_t value)
+    {
+        size_t bit = static_cast<size_t>(index) * bits;
+        uint64_t mask = ((1ull << bits) - 1) << (bit & 63);
+        uint64_t& word = data[bit >> 6];
+        word = (word & ~mask) | ((static_cast<uint64_t>(value) << (bit & 63)) & mask);
+    }
+
+    int bitsForPaletteSize(size_t size)
+    {
+        int bits = 1;
+        while ((size_t(1) << bits) < size)
+        {
+            bits *= 2;
+        }
+        return bits;
+    }
+}
+
+ChunkSection::ChunkSection(BlockId fill)
+{
+    this->fill(fill);
+}
+
+uint32_t ChunkSection::readIndex(int index) const
+{
+    return readPacked(m_data, m_bits, index);
+}
+
+void ChunkSection::writeIndex(int index, uint32_t value)
+{
+    writePacked(m_data, m_bits, index, value);
+}
+
+BlockId ChunkSection::getBlock(int x, int y, int z) const
+{
+    if (m_bits == 0)
+    {
+        return m_palette[0];
+    }
+
+    uint32_t value = readIndex(toIndex(x, y, z));
+    return m_bits == 16 ? static_cast<BlockId>(value) : m_palette[value];
+}
+
+uint32_t ChunkSection::findOrAddPaletteEntry(BlockId block)
+{
+    uint32_t freeSlot = UINT32_MAX;
+
+    for (uint32_t i = 0; i < m_palette.size(); ++i)
+    {
+        if (m_palette[i] == block)
+        {
+            return i;
+        }
+
+        if (freeSlot == UINT32_MAX && m_paletteCounts[i] == 0)
+        {
+            freeSlot = i;
+        }
+    }
+
+    if (freeSlot != UINT32_MAX)
+    {
+        m_palette[freeSlot] = block;
+        return freeSlot;
+    }
+
+    m_palette.push_back(block);
+    m_paletteCounts.push_back(0);
+
+    if (m_palette.size() > (size_t(1) << m_bits))
+    {
+        resize(m_palette.size() > MAX_PALETTE_SIZE ? 16 : m_bits * 2);
+    }
+
+    return static_cast<uint32_t>(m_palette.size() - 1);
+}
+
+void ChunkSection::resize(int bits)
+{
+    std::vector<uint64_t> old = std::move(m_data);
+    int oldBits = m_bits;
+
+    m_bits = bits;
+    m_data.assign(static_cast<size_t>(VOLUME) * bits / 64, 0);
+
+    for (int i = 0; i < VOLUME; ++i)
+    {
+        uint32_t value = oldBits == 0 ? 0 : readPacked(old, oldBits, i);
+
+        if (bits == 16)
+        {
+            value = m_palette[value];
+        }
+
+        writeIndex(i, value);
+    }
+
+    if (bits == 16)
+    {
+        m_palette.clear();
+        m_palette.shrink_to_fit();
+        m_paletteCounts.clear();
+        m_paletteCounts.shrink_to_fit();
+    }
+}
+
+BlockId ChunkSection::setBlock(int x, int y, int z, BlockId block)
+{
+    int index = toIndex(x, y, z);
+    BlockId previous;
+
+    if (m_bits == 16)
+    {
+        previous = static_cast<BlockId>(readIndex(index));
+        if (previous == block)
+        {
+            return previous;
+        }
+
+        writeIndex(index, block);
+    }
+    else
+    {
+        uint32_t oldEntry = m_bits == 0 ? 0 : readIndex(index);
+        previous = m_palette[oldEntry];
+        if (previous == block)
+        {
+            return previous;
+        }
+
+        if (m_bits == 0)
+        {
+            resize(1);
+        }
+
+        uint32_t newEntry = findOrAddPaletteEntry(block);
+
+        if (m_bits == 16)
+        {
+            // The palette overflowed and was dropped
+            writeIndex(index, block);
+        }
+        else
+        {
+            writeIndex(index, newEntry);
+            --m_paletteCounts[oldEntry];
+
+            if (++m_paletteCounts[newEntry] == VOLUME)
+            {
+                m_nonAirCount += (block != BLOCK_AIR) - (previous != BLOCK_AIR);
+                fill(block);
+                return previous;
+            }
+        }
+    }
+
+    m_nonAirCount += (block != BLOCK_AIR) - (previous != BLOCK_AIR);
+    return previous;
+}
+
+void ChunkSection::fill(BlockId block)
+{
+    m_bits = 0;
+    m_data.clear();
+    m_data.shrink_to_fit();
+
+    m_palette.assign(1, block);
+    m_paletteCounts.assign(1, static_cast<uint16_t>(VOLUME));
+
+    m_nonAirCount = block == BLOCK_AIR ? 0 : VOLUME;
+}
+
+void ChunkSection::compact()
+{
+    if (m_bits == 0)
+    {
+        return;
+    }
+
+    std::vector<BlockId> blocks(VOLUME);
+    for (int i = 0; i < VOLUME; ++i)
+    {
+        uint32_t value = readIndex(i);
+        blocks[i] = m_bits == 16 ? static_cast<BlockId>(value) : m_palette[value];
+    }
+
+    std::vector<BlockId> palette(blocks);
+    std::sort(palette.begin(), palette.end());
+    palette.erase(std::unique(palette.begin(), palette.end()), palette.end());
+
+    if (palette.size() == 1)
+    {
+        fill(palette[0]);
+        return;
+    }
+
+    int bits = palette.size() > MAX_PALETTE_SIZE ? 16 : bitsForPaletteSize(palette.size());
+
+    m_bits = bits;
+    m_data.assign(static_cast<size_t>(VOLUME) * bits / 64, 0);
+    m_data.shrink_to_fit();
+
+    if (bits == 16)
+    {
+        for (int i = 0; i < VOLUME; ++i)
+        {
+            writeIndex(i, blocks[i]);
+        }
+
+        m_palette.clear();
+        m_palette.shrink_to_fit();
+        m_paletteCounts.clear();
+        m_paletteCounts.shrink_to_fit();
+        return;
+    }
+
+    m_palette = palette;
+    m_paletteCounts.assign(palette.size(), 0);
+
+    for (int i = 0; i < VOLUME; ++i)
+    {
+        uint32_t entry = static_cast<uint32_t>(std::lower_bound(palette.begin(), palette.end(), blocks[i]) - palette.begin());
+        writeIndex(i, entry);
+        ++m_paletteCounts[entry];
+    }
+}
+
+size_t ChunkSection::getMemoryUsage() const
+{
+    return sizeof(ChunkSection)
+        + m_palette.capacity() * sizeof(BlockId)
+        + m_paletteCounts.capacity() * sizeof(uint16_t)
+        + m_data.capacity() * sizeof(uint64_t);
+}
+
+void ChunkSection::serialize(ByteWriter& writer) const
+{
+    writer.write(static_cast<uint8_t>(m_bits));
+    writer.write(static_cast<uint16_t>(m_palette.size()));
+    writer.writeBytes(m_palette.data(), m_palette.size() * sizeof(BlockId));
+    writer.writeBytes(m_data.data(), m_data.size() * sizeof(uint64_t));
+}
+
+bool ChunkSection::deserialize(ByteReader& reader)
+{
+    int bits = reader.read<uint8_t>();
+    size_t paletteSize = reader.read<uint16_t>();
+
+    bool validBits = bits == 0 || bits == 1 || bits == 2 || bits == 4 || bits == 8 || bits == 16;
+    bool validPalette = bits == 16 ? paletteSize == 0 : (paletteSize >= 1 && paletteSize <= (size_t(1) << std::max(bits, 0)));
+    if (reader.hasFailed() || !validBits || !validPalette)
+    {
+        fill(BLOCK_AIR);
+        return false;
+    }
+
+    m_palette.resize(paletteSize);
+    reader.readBytes(m_palette.data(), paletteSize * sizeof(BlockId));
+
+    m_bits = bits;
+    m_data.resize(static_cast<size_t>(VOLUME) * bits / 64);
+    reader.readBytes(m_data.data(), m_data.size() * sizeof(uint64_t));
+
+    if (reader.hasFailed())
+    {
+        fill(BLOCK_AIR);
+        return false;
+    }
+
+    if (bits == 0)
+    {
+        fill(m_palette[0]);
+        return true;
+    }
+
+    // Counts aren't stored, rebuild them and check every index is in the palette
+    m_paletteCounts.assign(paletteSize, 0);
+    m_nonAirCount = 0;
+
+    for (int i = 0; i < VOLUME; ++i)
+    {
+        uint32_t value = readIndex(i);
+        BlockId block;
+
+        if (bits == 16)
+        {
+            block = static_cast<BlockId>(value);
+        }
+        else if (value < paletteSize)
+        {
+            block = m_palette[value];
+            ++m_paletteCounts[value];
+        }
+        else
+        {
+            fill(BLOCK_AIR);
+            return false;
+        }
+
+        m_nonAirCount += block != BLOCK_AIR;
+    }
+
+    return true;
+}
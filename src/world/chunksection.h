@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "block.h"
+
+class ByteWriter;
+class ByteReader;
+
+// A 16x16x16 cube of blocks. Blocks are stored as indices into a small per-section palette,
+// bit-packed into 64-bit words, and the index width grows as more distinct blocks appear.
+// A section holding a single block type (all air, solid stone) keeps no index data at all
+class ChunkSection
+{
+public:
+    static constexpr int SIZE = 16;
+    static constexpr int VOLUME = SIZE * SIZE * SIZE;
+
+    // Past this many distinct blocks the palette is dropped and block IDs are stored directly
+    static constexpr size_t MAX_PALETTE_SIZE = 256;
+
+private:
+    std::vector<BlockId> m_palette;
+
+    // How many blocks use each palette entry, so entries can be recycled and uniform sections detected
+    std::vector<uint16_t> m_paletteCounts;
+
+    std::vector<uint64_t> m_data;
+
+    // Bits per block index. 0 = uniform, 16 = direct block IDs without a palette
+    int m_bits = 0;
+
+    int m_nonAirCount = 0;
+
+    static int toIndex(int x, int y, int z) { return (y << 8) | (z << 4) | x; }
+
+    uint32_t readIndex(int index) const;
+
+    void writeIndex(int index, uint32_t value);
+
+    uint32_t findOrAddPaletteEntry(BlockId block);
+
+    void resize(int bits);
+
+public:
+    explicit ChunkSection(BlockId fill = BLOCK_AIR);
+
+    BlockId getBlock(int x, int y, int z) const;
+
+    // Returns the block that was replaced
+    BlockId setBlock(int x, int y, int z, BlockId block);
+
+    void fill(BlockId block);
+
+    // Rebuilds the palette from the blocks actually present and packs indices as tightly as possible.
+    // Worth calling after heavy editing or before saving
+    void compact();
+
+    bool isUniform() const { return m_bits == 0; }
+
+    bool isEmpty() const { return m_nonAirCount == 0; }
+
+    int getNonAirCount() const { return m_nonAirCount; }
+
+    int getBitsPerBlock() const { return m_bits; }
+
+    size_t getPaletteSize() const { return m_palette.size(); }
+
+    // Heap and inline bytes held by this section
+    size_t getMemoryUsage() const;
+
+    void serialize(ByteWriter& writer) const;
+
+    // Returns false and leaves the section empty if the data is malformed
+    bool deserialize(ByteReader& reader);
+};
@@ -0,0 +1,646 @@
+#include "lightengine.h"
+#include "world.h"
+#include "chunk.h"
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
+using Clock = std::chrono::high_resolution_clock;
+
+static double elapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+namespace
+{
+    enum LightType
+    {
+        LIGHT_SKY,
+        LIGHT_BLOCK
+    };
+
+    struct LightNode
+    {
+        int x, y, z;
+        uint8_t level;
+    };
+
+    const int DIRECTIONS[6][3] = { { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 }, { -1, 0, 0 }, { 1, 0, 0 } };
+    const int DOWN = 0;
+
+    int floorMod3(int value)
+    {
+        return ((value % 3) + 3) % 3;
+    }
+
+    // Relights one chunk update. Only ever touches the 3x3 chunks it was given
+    class LightJob
+    {
+    private:
+        const std::vector<LightProperties>& m_properties;
+
+        Chunk* m_chunks[3][3];
+        int m_chunkX = 0;
+        int m_chunkZ = 0;
+
+        // World block coordinates of the north west corner of the 3x3 area
+        int m_baseX = 0;
+        int m_baseZ = 0;
+
+        std::vector<LightNode> m_add;
+        std::vector<LightNode> m_remove;
+
+        // Sections of the surrounding 5x5 chunks whose mesh saw a light change
+        bool m_dirty[5][5][Chunk::SECTION_COUNT];
+
+        size_t m_cellsChanged = 0;
+
+        Chunk* chunkAt(int x, int z) const
+        {
+            unsigned int lx = static_cast<unsigned int>(x - m_baseX);
+            unsigned int lz = static_cast<unsigned int>(z - m_baseZ);
+            if (lx >= 3 * Chunk::SIZE || lz >= 3 * Chunk::SIZE)
+            {
+                return nullptr;
+            }
+            return m_chunks[lz >> 4][lx >> 4];
+        }
+
+        const LightProperties& properties(BlockId block) const
+        {
+            static const LightProperties air{ 0, 0 };
+            static const LightProperties unknown;
+            if (block == BLOCK_AIR)
+            {
+                return air;
+            }
+            return block < m_properties.size() ? m_properties[block] : unknown;
+        }
+
+        uint8_t getLight(LightType type, const Chunk* chunk, int x, int y, int z) const
+        {
+            return type == LIGHT_SKY ? chunk->getSkyLight(x & 15, y, z & 15) : chunk->getBlockLight(x & 15, y, z & 15);
+        }
+
+        void setLight(LightType type, Chunk* chunk, int x, int y, int z, uint8_t level)
+        {
+            if (type == LIGHT_SKY)
+            {
+                chunk->setSkyLight(x & 15, y, z & 15, level);
+            }
+            else
+            {
+                chunk->setBlockLight(x & 15, y, z & 15, level);
+            }
+
+            ++m_cellsChanged;
+            markDirty(x, y, z);
+        }
+
+        void markDirty(int x, int y, int z)
+        {
+            // Relative to the corner of the 5x5 area, so x - 1 and x + 1 stay in range
+            int lx = x - m_baseX + Chunk::SIZE;
+            int lz = z - m_baseZ + Chunk::SIZE;
+
+            int minY = std::max((y - 1) >> 4, 0);
+            int maxY = std::min((y + 1) >> 4, Chunk::SECTION_COUNT - 1);
+
+            for (int sz = (lz - 1) >> 4; sz <= (lz + 1) >> 4; ++sz)
+            {
+                for (int sx = (lx - 1) >> 4; sx <= (lx + 1) >> 4; ++sx)
+                {
+                    for (int sy = minY; sy <= maxY; ++sy)
+                    {
+                        m_dirty[sz][sx][sy] = true;
+                    }
+                }
+            }
+        }
+
+        void pushAdd(int x, int y, int z)
+        {
+            if (y >= 0 && y < Chunk::HEIGHT && chunkAt(x, z))
+            {
+                m_add.push_back({ x, y, z, 0 });
+            }
+        }
+
+        void propagateAdd(LightType type)
+        {
+            for (size_t head = 0; head < m_add.size(); ++head)
+            {
+                const LightNode node = m_add[head];
+
+                int level = getLight(type, chunkAt(node.x, node.z), node.x, node.y, node.z);
+                if (level <= 1)
+                {
+                    continue;
+                }
+
+                for (int dir = 0; dir < 6; ++dir)
+                {
+                    int x = node.x + DIRECTIONS[dir][0];
+                    int y = node.y + DIRECTIONS[dir][1];
+                    int z = node.z + DIRECTIONS[dir][2];
+
+                    Chunk* chunk = chunkAt(x, z);
+                    if (!chunk || y < 0 || y >= Chunk::HEIGHT)
+                    {
+                        continue;
+                    }
+
+                    int opacity = properties(chunk->getBlock(x & 15, y, z & 15)).opacity;
+                    if (opacity >= 15)
+                    {
+                        continue;
+                    }
+
+                    // Full sky light falls straight down through clear blocks without dimming
+                    int next = (type == LIGHT_SKY && dir == DOWN && level == 15 && opacity == 0) ? 15 : level - std::max(1, opacity);
+
+                    if (next > getLight(type, chunk, x, y, z))
+                    {
+                        setLight(type, chunk, x, y, z, static_cast<uint8_t>(next));
+                        m_add.push_back({ x, y, z, 0 });
+                    }
+                }
+            }
+
+            m_add.clear();
+        }
+
+        void propagateRemove(LightType type)
+        {
+            for (size_t head = 0; head < m_remove.size(); ++head)
+            {
+                const LightNode node = m_remove[head];
+
+                for (int dir = 0; dir < 6; ++dir)
+                {
+                    int x = node.x + DIRECTIONS[dir][0];
+                    int y = node.y + DIRECTIONS[dir][1];
+                    int z = node.z + DIRECTIONS[dir][2];
+
+                    Chunk* chunk = chunkAt(x, z);
+                    if (!chunk || y < 0 || y >= Chunk::HEIGHT)
+                    {
+                        continue;
+                    }
+
+                    uint8_t level = getLight(type, chunk, x, y, z);
+                    if (level == 0)
+                    {
+                        continue;
+                    }
+
+                    bool skyColumn = type == LIGHT_SKY && dir == DOWN && node.level == 15 && level == 15;
+
+                    if (level < node.level || skyColumn)
+                    {
+                        // Lit by the removed light, clear it and keep going
+                        setLight(type, chunk, x, y, z, 0);
+                        m_remove.push_back({ x, y, z, level });
+
+                        if (type == LIGHT_BLOCK)
+                        {
+                            uint8_t emission = properties(chunk->getBlock(x & 15, y, z & 15)).emission;
+                            if (emission > 0)
+                            {
+                                setLight(type, chunk, x, y, z, emission);
+                                m_add.push_back({ x, y, z, 0 });
+                            }
+                        }
+                    }
+                    else
+                    {
+                        // Lit from somewhere else, it refills the hole afterwards
+                        m_add.push_back({ x, y, z, 0 });
+                    }
+                }
+            }
+
+            m_remove.clear();
+        }
+
+        void updateHeight(Chunk* chunk, int x, int y, int z)
+        {
+            int lx = x & 15;
+            int lz = z & 15;
+            int height = chunk->getHeight(lx, lz);
+
+            if (properties(chunk->getBlock(lx, y, lz)).opacity > 0)
+            {
+                if (y >= height)
+                {
+                    chunk->setHeight(lx, lz, y + 1);
+                }
+            }
+            else if (y == height - 1)
+            {
+                while (y > 0 && properties(chunk->getBlock(lx, y - 1, lz)).opacity == 0)
+                {
+                    --y;
+                }
+                chunk->setHeight(lx, lz, y);
+            }
+        }
+
+        void initialize()
+        {
+            Chunk* chunk = m_chunks[1][1];
+            int originX = m_chunkX * Chunk::SIZE;
+            int originZ = m_chunkZ * Chunk::SIZE;
+
+            // Heightmap, skipping empty sections
+            int minHeight = Chunk::HEIGHT;
+            int maxHeight = 0;
+
+            for (int z = 0; z < Chunk::SIZE; ++z)
+            {
+                for (int x = 0; x < Chunk::SIZE; ++x)
+                {
+                    int height = 0;
+                    for (int s = Chunk::SECTION_COUNT - 1; s >= 0 && height == 0; --s)
+                    {
+                        const ChunkSection& section = chunk->getSection(s);
+                        if (section.isEmpty())
+                        {
+                            continue;
+                        }
+
+                        for (int y = ChunkSection::SIZE - 1; y >= 0; --y)
+                        {
+                            if (properties(section.getBlock(x, y, z)).opacity > 0)
+                            {
+                                height = s * ChunkSection::SIZE + y + 1;
+                                break;
+                            }
+                        }
+                    }
+
+                    chunk->setHeight(x, z, height);
+                    minHeight = std::min(minHeight, height);
+                    maxHeight = std::max(maxHeight, height);
+                }
+            }
+
+            // Open sky above the heightmap, dark below it. Whole sections stay uniform where they can
+            for (int s = 0; s < Chunk::SECTION_COUNT; ++s)
+            {
+                int bottom = s * ChunkSection::SIZE;
+
+                chunk->getBlockLightSection(s).fill(0);
+
+                if (bottom >= maxHeight)
+                {
+                    chunk->getSkyLightSection(s).fill(15);
+                    continue;
+                }
+
+                chunk->getSkyLightSection(s).fill(0);
+
+                if (bottom + ChunkSection::SIZE <= minHeight)
+                {
+                    continue;
+                }
+
+                for (int z = 0; z < Chunk::SIZE; ++z)
+                {
+                    for (int x = 0; x < Chunk::SIZE; ++x)
+                    {
+                        for (int y = std::max(bottom, chunk->getHeight(x, z)); y < bottom + ChunkSection::SIZE; ++y)
+                        {
+                            chunk->setSkyLight(x, y, z, 15);
+                        }
+                    }
+                }
+            }
+
+            for (int sz = 0; sz < 5; ++sz)
+            {
+                for (int sx = 0; sx < 5; ++sx)
+                {
+                    std::fill(m_dirty[sz][sx], m_dirty[sz][sx] + Chunk::SECTION_COUNT, sz >= 1 && sz <= 3 && sx >= 1 && sx <= 3);
+                }
+            }
+
+            // Sky light spills sideways under overhangs, in both directions across the border
+            for (int z = 0; z < Chunk::SIZE; ++z)
+            {
+                for (int x = 0; x < Chunk::SIZE; ++x)
+                {
+                    int height = chunk->getHeight(x, z);
+
+                    for (int dir = 2; dir < 6; ++dir)
+                    {
+                        int nx = originX + x + DIRECTIONS[dir][0];
+                        int nz = originZ + z + DIRECTIONS[dir][2];
+
+                        Chunk* neighbour = chunkAt(nx, nz);
+                        if (!neighbour)
+                        {
+                            continue;
+                        }
+
+                        int neighbourHeight = neighbour->getHeight(nx & 15, nz & 15);
+
+                        for (int y = height; y < neighbourHeight; ++y)
+                        {
+                            m_add.push_back({ originX + x, y, originZ + z, 0 });
+                        }
+
+                        if (neighbour != chunk)
+                        {
+                            for (int y = neighbourHeight; y < height; ++y)
+                            {
+                                m_add.push_back({ nx, y, nz, 0 });
+                            }
+
+                            // Light the neighbour already spread into caves below its surface
+                            for (int y = 0; y < std::min(neighbourHeight, height); ++y)
+                            {
+                                if (neighbour->getSkyLight(nx & 15, y, nz & 15) > 1)
+                                {
+                                    m_add.push_back({ nx, y, nz, 0 });
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+
+            propagateAdd(LIGHT_SKY);
+
+            // Emitters inside the chunk, then block light bordering it
+            for (int s = 0; s < Chunk::SECTION_COUNT; ++s)
+            {
+                const ChunkSection& section = chunk->getSection(s);
+                if (section.isEmpty())
+                {
+                    continue;
+                }
+
+                for (int y = 0; y < ChunkSection::SIZE; ++y)
+                {
+                    for (int z = 0; z < ChunkSection::SIZE; ++z)
+                    {
+                        for (int x = 0; x < ChunkSection::SIZE; ++x)
+                        {
+                            uint8_t emission = properties(section.getBlock(x, y, z)).emission;
+                            if (emission > 0)
+                            {
+                                int wy = s * ChunkSection::SIZE + y;
+                                setLight(LIGHT_BLOCK, chunk, originX + x, wy, originZ + z, emission);
+                                m_add.push_back({ originX + x, wy, originZ + z, 0 });
+                            }
+                        }
+                    }
+                }
+            }
+
+            for (int i = 0; i < Chunk::SIZE; ++i)
+            {
+                const int border[4][2] = { { originX - 1, originZ + i }, { originX + Chunk::SIZE, originZ + i },
+                                           { originX + i, originZ - 1 }, { originX + i, originZ + Chunk::SIZE } };
+
+                for (const auto& cell : border)
+                {
+                    Chunk* neighbour = chunkAt(cell[0], cell[1]);
+                    if (!neighbour)
+                    {
+                        continue;
+                    }
+
+                    for (int y = 0; y < Chunk::HEIGHT; ++y)
+                    {
+                        if (neighbour->getBlockLight(cell[0] & 15, y, cell[1] & 15) > 1)
+                        {
+                            m_add.push_back({ cell[0], y, cell[1], 0 });
+                        }
+                    }
+                }
+            }
+
+            propagateAdd(LIGHT_BLOCK);
+        }
+
+        void applyChanges(const std::vector<Vec3<int>>& blocks)
+        {
+            for (const Vec3<int>& block : blocks)
+            {
+                updateHeight(chunkAt(block.x, block.z), block.x, block.y, block.z);
+            }
+
+            for (LightType type : { LIGHT_SKY, LIGHT_BLOCK })
+            {
+                for (const Vec3<int>& block : blocks)
+                {
+                    Chunk* chunk = chunkAt(block.x, block.z);
+                    uint8_t level = getLight(type, chunk, block.x, block.y, block.z);
+                    if (level > 0)
+                    {
+                        setLight(type, chunk, block.x, block.y, block.z, 0);
+                        m_remove.push_back({ block.x, block.y, block.z, level });
+                    }
+                }
+
+                propagateRemove(type);
+
+                for (const Vec3<int>& block : blocks)
+                {
+                    Chunk* chunk = chunkAt(block.x, block.z);
+
+                    uint8_t source;
+                    if (type == LIGHT_SKY)
+                    {
+                        source = block.y >= chunk->getHeight(block.x & 15, block.z & 15) ? 15 : 0;
+                    }
+                    else
+                    {
+                        source = properties(chunk->getBlock(block.x & 15, block.y, block.z & 15)).emission;
+                    }
+
+                    if (source > getLight(type, chunk, block.x, block.y, block.z))
+                    {
+                        setLight(type, chunk, block.x, block.y, block.z, source);
+                    }
+                    pushAdd(block.x, block.y, block.z);
+
+                    // Neighbours flow back into a block that became clearer
+                    for (const auto& dir : DIRECTIONS)
+                    {
+                        pushAdd(block.x + dir[0], block.y + dir[1], block.z + dir[2]);
+                    }
+                }
+
+                propagateAdd(type);
+            }
+        }
+
+    public:
+        LightJob(const std::vector<LightProperties>& properties) : m_properties(properties)
+        {
+        }
+
+        void process(World& world, const LightEngine::ChunkUpdate& update, std::vector<SectionPos>& dirty)
+        {
+            m_chunkX = update.chunkX;
+            m_chunkZ = update.chunkZ;
+            m_baseX = (update.chunkX - 1) * Chunk::SIZE;
+            m_baseZ = (update.chunkZ - 1) * Chunk::SIZE;
+
+            // Lookups only, the chunk map isn't modified while lighting runs
+            for (int dz = -1; dz <= 1; ++dz)
+            {
+                for (int dx = -1; dx <= 1; ++dx)
+                {
+                    m_chunks[dz + 1][dx + 1] = world.getChunk(update.chunkX + dx, update.chunkZ + dz);
+                }
+            }
+
+            std::fill_n(&m_dirty[0][0][0], 5 * 5 * Chunk::SECTION_COUNT, false);
+
+            if (update.initialize)
+            {
+                initialize();
+            }
+            else
+            {
+                applyChanges(update.blocks);
+            }
+
+            for (int sz = 0; sz < 5; ++sz)
+            {
+                for (int sx = 0; sx < 5; ++sx)
+                {
+                    for (int sy = 0; sy < Chunk::SECTION_COUNT; ++sy)
+                    {
+                        if (m_dirty[sz][sx][sy])
+                        {
+                            dirty.push_back({ update.chunkX + sx - 2, sy, update.chunkZ + sz - 2 });
+                        }
+                    }
+                }
+            }
+        }
+
+        size_t getCellsChanged() const { return m_cellsChanged; }
+    };
+}
+
+LightEngine::LightEngine(const std::vector<LightProperties>& properties) : m_properties(properties)
+{
+}
+
+LightEngine::ChunkUpdate& LightEngine::getUpdate(int chunkX, int chunkZ)
+{
+    uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(chunkX)) << 32) | static_cast<uint32_t>(chunkZ);
+
+    auto it = m_updateIndices.find(key);
+    if (it != m_updateIndices.end())
+    {
+        return m_updates[it->second];
+    }
+
+    m_updateIndices.emplace(key, m_updates.size());
+    m_updates.push_back({ chunkX, chunkZ, false, {} });
+    return m_updates.back();
+}
+
+void LightEngine::initializeChunk(int chunkX, int chunkZ)
+{
+    ChunkUpdate& update = getUpdate(chunkX, chunkZ);
+    update.initialize = true;
+    update.blocks.clear();
+}
+
+void LightEngine::onBlockChanged(int x, int y, int z)
+{
+    if (y < 0 || y >= Chunk::HEIGHT)
+    {
+        return;
+    }
+
+    ChunkUpdate& update = getUpdate(World::toChunk(x), World::toChunk(z));
+
+    // Relighting the whole chunk covers it already
+    if (!update.initialize)
+    {
+        update.blocks.push_back({ x, y, z });
+    }
+}
+
+void LightEngine::update(World& world)
+{
+    run(world, nullptr);
+}
+
+void LightEngine::update(World& world, ThreadPool& pool)
+{
+    run(world, &pool);
+}
+
+void LightEngine::run(World& world, ThreadPool* pool)
+{
+    Clock::time_point start = Clock::now();
+
+    m_stats = Stats();
+
+    std::vector<SectionPos> dirty;
+    std::mutex dirtyMutex;
+
+    std::vector<const ChunkUpdate*> phase;
+
+    for (int phaseZ = 0; phaseZ < 3; ++phaseZ)
+    {
+        for (int phaseX = 0; phaseX < 3; ++phaseX)
+        {
+            phase.clear();
+            for (const ChunkUpdate& update : m_updates)
+            {
+                if (floorMod3(update.chunkX) == phaseX && floorMod3(update.chunkZ) == phaseZ && world.getChunk(update.chunkX, update.chunkZ))
+                {
+                    phase.push_back(&update);
+                    ++m_stats.chunkUpdates;
+                    m_stats.blockUpdates += update.blocks.size();
+                }
+            }
+
+            auto work = [&](size_t begin, size_t end)
+            {
+                LightJob job(m_properties);
+                std::vector<SectionPos> jobDirty;
+
+                for (size_t i = begin; i < end; ++i)
+                {
+                    job.process(world, *phase[i], jobDirty);
+                }
+
+                const std::lock_guard<std::mutex> lock(dirtyMutex);
+                dirty.insert(dirty.end(), jobDirty.begin(), jobDirty.end());
+                m_stats.cellsChanged += job.getCellsChanged();
+            };
+
+            if (pool && phase.size() > 1)
+            {
+                pool->parallelFor(phase.size(), 1, work);
+            }
+            else if (!phase.empty())
+            {
+                work(0, phase.size());
+            }
+        }
+    }
+
+    for (const SectionPos& pos : dirty)
+    {
+        world.markSectionDirty(pos);
+    }
+
+    m_updates.clear();
+    m_updateIndices.clear();
+
+    m_stats.ms = elapsedMs(start);
+}
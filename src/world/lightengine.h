@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include "block.h"
+#include "../utility/vec.h"
+#include "../utility/threadpool.h"
+
+class World;
+
+// How a block takes part in lighting, indexed by BlockId. Air is always fully transparent
+struct LightProperties
+{
+    uint8_t emission = 0;
+
+    // Light lost passing into the block, 15 stops it completely
+    uint8_t opacity = 15;
+};
+
+// Sky and block light, spread with breadth first flood fills. Darkening uses the two pass
+// removal scheme: light that came from a removed source is cleared first, then refilled
+// from whatever brighter light borders the cleared area.
+//
+// Changes are queued per chunk and applied in update(). Light never travels more than 15 blocks
+// sideways, so a chunk's update only touches the 3x3 chunks around it. Chunks three apart in
+// both axes can therefore be lit in parallel, and update() runs the nine such groups one after another
+class LightEngine
+{
+public:
+    struct Stats
+    {
+        size_t chunkUpdates = 0;
+        size_t blockUpdates = 0;
+
+        // Light values written
+        size_t cellsChanged = 0;
+
+        double ms = 0.0;
+    };
+
+    struct ChunkUpdate
+    {
+        int chunkX;
+        int chunkZ;
+
+        // Relight from scratch, for new chunks
+        bool initialize = false;
+
+        std::vector<Vec3<int>> blocks;
+    };
+
+private:
+    std::vector<LightProperties> m_properties;
+
+    std::vector<ChunkUpdate> m_updates;
+    std::unordered_map<uint64_t, size_t> m_updateIndices;
+
+    Stats m_stats;
+
+    ChunkUpdate& getUpdate(int chunkX, int chunkZ);
+
+    void run(World& world, ThreadPool* pool);
+
+public:
+    LightEngine(const std::vector<LightProperties>& properties);
+
+    // Seeds the heightmap and sky light of a newly filled chunk and pulls in light from its neighbours
+    void initializeChunk(int chunkX, int chunkZ);
+
+    // Call after a block changed, whatever the change was
+    void onBlockChanged(int x, int y, int z);
+
+    bool hasPendingUpdates() const { return !m_updates.empty(); }
+
+    // Applies every queued change and marks sections whose light changed dirty in the world
+    void update(World& world);
+
+    void update(World& world, ThreadPool& pool);
+
+    // Stats of the last update
+    const Stats& getStats() const { return m_stats; }
+};
@@ -0,0 +1,201 @@
+#include "meshingpipeline.h"
+#include "world.h"
+#include "../memory/pointers.h"
+#include <algorithm>
+#include <chrono>
+
+using Clock = std::chrono::high_resolution_clock;
+
+static double elapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static size_t meshBytes(const ChunkMesher::Mesh& mesh)
+{
+    // BufferBuilder narrows indices to 16 bits whenever they fit
+    size_t indexSize = mesh.vertices.size() <= 0xFFFF ? sizeof(unsigned short) : sizeof(unsigned int);
+    return mesh.vertices.size() * sizeof(ChunkMesher::PackedVertex) + mesh.indices.size() * indexSize;
+}
+
+MeshingPipeline::MeshingPipeline(const std::vector<BlockModel>& models, ThreadPool& pool, size_t maxInFlight)
+    : m_models(models), m_pool(pool), m_maxInFlight(std::max<size_t>(1, maxInFlight))
+{
+}
+
+MeshingPipeline::~MeshingPipeline()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_jobDone.wait(lock, [this] { return m_inFlight == 0; });
+}
+
+void MeshingPipeline::markDirty(const SectionPos& pos)
+{
+    ++m_versions[pos].version;
+    m_pending.insert(pos);
+}
+
+void MeshingPipeline::markDirty(World& world)
+{
+    m_dispatchOrder.clear();
+    world.takeDirtySections(m_dispatchOrder);
+
+    for (const SectionPos& pos : m_dispatchOrder)
+    {
+        markDirty(pos);
+    }
+}
+
+void MeshingPipeline::remove(const SectionPos& pos)
+{
+    m_pending.erase(pos);
+
+    // With results still on the way the entry has to stay, or a later version number could
+    // collide with theirs. Bumping it makes them stale and the last one releases the entry
+    auto it = m_versions.find(pos);
+    if (it != m_versions.end())
+    {
+        ++it->second.version;
+        release(pos);
+    }
+}
+
+void MeshingPipeline::release(const SectionPos& pos)
+{
+    auto it = m_versions.find(pos);
+    if (it != m_versions.end() && it->second.outstanding == 0 && m_pending.count(pos) == 0)
+    {
+        m_versions.erase(it);
+    }
+}
+
+void MeshingPipeline::dispatch(const World& world, const SectionPos& focus)
+{
+    size_t inFlight;
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        inFlight = m_inFlight;
+    }
+
+    size_t slots = inFlight < m_maxInFlight ? m_maxInFlight - inFlight : 0;
+    if (slots > 0 && !m_pending.empty())
+    {
+        m_dispatchOrder.assign(m_pending.begin(), m_pending.end());
+
+        auto distance = [&focus](const SectionPos& pos)
+        {
+            int dx = pos.x - focus.x;
+            int dy = pos.y - focus.y;
+            int dz = pos.z - focus.z;
+            return dx * dx + dy * dy + dz * dz;
+        };
+
+        size_t count = std::min(slots, m_dispatchOrder.size());
+        std::partial_sort(m_dispatchOrder.begin(), m_dispatchOrder.begin() + count, m_dispatchOrder.end(),
+            [&distance](const SectionPos& a, const SectionPos& b) { return distance(a) < distance(b); });
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const SectionPos pos = m_dispatchOrder[i];
+            m_pending.erase(pos);
+
+            SharedPtr<ChunkMesher::Snapshot> snapshot = MakeShared<ChunkMesher::Snapshot>();
+            ChunkMesher::takeSnapshot(world, pos.x, pos.y, pos.z, *snapshot);
+
+            Tracking& tracking = m_versions[pos];
+            ++tracking.outstanding;
+            uint32_t version = tracking.version;
+
+            if (snapshot->empty)
+            {
+                // Nothing to mesh, hand back an empty mesh so the old one gets freed
+                const std::lock_guard<std::mutex> lock(m_mutex);
+                m_results.push_back({ pos, version, {}, {} });
+                continue;
+            }
+
+            {
+                const std::lock_guard<std::mutex> lock(m_mutex);
+                ++m_inFlight;
+            }
+
+            m_pool.submit([this, pos, version, snapshot]
+            {
+                Result result{ pos, version, {}, {} };
+
+                ChunkMesher mesher(m_models);
+                mesher.mesh(*snapshot, result.mesh);
+                result.stats = mesher.getStats();
+
+                // Notified under the lock, the destructor may return as soon as it sees m_inFlight
+                // reach zero and the condition variable has to outlive this call
+                const std::lock_guard<std::mutex> lock(m_mutex);
+                m_results.push_back(std::move(result));
+                --m_inFlight;
+                m_jobDone.notify_all();
+            });
+        }
+    }
+
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.pending = m_pending.size();
+    m_stats.inFlight = m_inFlight;
+    m_stats.waiting = m_results.size();
+}
+
+void MeshingPipeline::upload(size_t byteBudget, double msBudget, const UploadCallback& upload)
+{
+    Clock::time_point start = Clock::now();
+
+    m_stats.uploaded = 0;
+    m_stats.uploadedBytes = 0;
+
+    while (true)
+    {
+        Result result;
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_results.empty())
+            {
+                break;
+            }
+
+            size_t bytes = meshBytes(m_results.front().mesh);
+            bool overBudget = m_stats.uploadedBytes + bytes > byteBudget || elapsedMs(start) >= msBudget;
+            if (m_stats.uploaded > 0 && overBudget)
+            {
+                break;
+            }
+
+            result = std::move(m_results.front());
+            m_results.pop_front();
+        }
+
+        m_stats.meshMs += result.stats.meshMs;
+
+        // Every result was counted when it was dispatched, so the entry is still there
+        Tracking& tracking = m_versions[result.pos];
+        --tracking.outstanding;
+
+        bool current = tracking.version == result.version;
+        release(result.pos);
+
+        if (!current)
+        {
+            ++m_stats.discarded;
+            continue;
+        }
+
+        upload(result.pos, result.mesh);
+
+        ++m_stats.meshed;
+        ++m_stats.uploaded;
+        m_stats.uploadedBytes += meshBytes(result.mesh);
+    }
+
+    m_stats.uploadMs = elapsedMs(start);
+
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.inFlight = m_inFlight;
+    m_stats.waiting = m_results.size();
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+#include "chunkmesher.h"
+#include "sectionpos.h"
+#include "../utility/threadpool.h"
+
+class World;
+
+// Meshes dirty sections on the thread pool and hands the results back to the main thread
+// for upload, a bounded amount per frame. Each job works on a snapshot taken when it was
+// dispatched, and a result is dropped if its section was marked dirty again since
+class MeshingPipeline
+{
+public:
+    using UploadCallback = std::function<void(const SectionPos&, const ChunkMesher::Mesh&)>;
+
+    struct Stats
+    {
+        size_t pending = 0;
+        size_t inFlight = 0;
+        size_t waiting = 0;
+
+        // Last upload call
+        size_t uploaded = 0;
+        size_t uploadedBytes = 0;
+        double uploadMs = 0.0;
+
+        // Totals
+        size_t meshed = 0;
+        size_t discarded = 0;
+        double meshMs = 0.0;
+    };
+
+private:
+    // Kept only while a section is pending or has results on the way, so sections the player has
+    // left behind don't pile up
+    struct Tracking
+    {
+        uint32_t version = 0;
+
+        // Results dispatched and not yet taken by upload()
+        uint32_t outstanding = 0;
+    };
+
+    struct Result
+    {
+        SectionPos pos;
+        uint32_t version;
+        ChunkMesher::Mesh mesh;
+        ChunkMesher::Stats stats;
+    };
+
+    const std::vector<BlockModel>& m_models;
+    ThreadPool& m_pool;
+    size_t m_maxInFlight;
+
+    // Drops a section's tracking once nothing refers to its version any more
+    void release(const SectionPos& pos);
+
+    // Main thread only
+    std::unordered_set<SectionPos> m_pending;
+    std::unordered_map<SectionPos, Tracking> m_versions;
+    std::vector<SectionPos> m_dispatchOrder;
+    Stats m_stats;
+
+    // Shared with the workers
+    std::mutex m_mutex;
+    std::condition_variable m_jobDone;
+    std::deque<Result> m_results;
+    size_t m_inFlight = 0;
+
+public:
+    // models has to outlive the pipeline
+    MeshingPipeline(const std::vector<BlockModel>& models, ThreadPool& pool, size_t maxInFlight = 64);
+
+    // Waits for jobs still running
+    ~MeshingPipeline();
+
+    MeshingPipeline(const MeshingPipeline& other) = delete;
+
+    MeshingPipeline& operator=(const MeshingPipeline& other) = delete;
+
+    void markDirty(const SectionPos& pos);
+
+    // Takes the sections the world's edits dirtied since the last call
+    void markDirty(World& world);
+
+    // Forgets a section that's being unloaded, its in-flight result gets thrown away
+    void remove(const SectionPos& pos);
+
+    // Snapshots pending sections closest to focus and queues them, up to the in-flight limit
+    void dispatch(const World& world, const SectionPos& focus);
+
+    // Passes finished meshes to upload until the byte or time budget runs out. At least one
+    // mesh goes through per call so a single huge section can't stall the queue
+    void upload(size_t byteBudget, double msBudget, const UploadCallback& upload);
+
+    const Stats& getStats() const { return m_stats; }
+};
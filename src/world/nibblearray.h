@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "chunksection.h"
+#include "../io/bytebuffer.h"
+
+// One 4-bit value per block of a section, laid out like the section itself. Until a value differs
+// from the fill no storage is allocated, which keeps open sky and solid rock free
+class NibbleArray
+{
+public:
+    static constexpr int BYTES = ChunkSection::VOLUME / 2;
+
+private:
+    std::vector<uint8_t> m_data;
+    uint8_t m_fill = 0;
+
+    static int toIndex(int x, int y, int z) { return (y << 8) | (z << 4) | x; }
+
+public:
+    explicit NibbleArray(uint8_t fill = 0) : m_fill(fill) {}
+
+    uint8_t get(int x, int y, int z) const
+    {
+        if (m_data.empty())
+        {
+            return m_fill;
+        }
+
+        int index = toIndex(x, y, z);
+        return (m_data[index >> 1] >> ((index & 1) << 2)) & 15;
+    }
+
+    void set(int x, int y, int z, uint8_t value)
+    {
+        if (m_data.empty())
+        {
+            if (value == m_fill)
+            {
+                return;
+            }
+            m_data.assign(BYTES, static_cast<uint8_t>(m_fill | (m_fill << 4)));
+        }
+
+        int index = toIndex(x, y, z);
+        int shift = (index & 1) << 2;
+        uint8_t& byte = m_data[index >> 1];
+        byte = static_cast<uint8_t>((byte & ~(15 << shift)) | ((value & 15) << shift));
+    }
+
+    void fill(uint8_t value)
+    {
+        m_data.clear();
+        m_data.shrink_to_fit();
+        m_fill = value;
+    }
+
+    bool isUniform() const { return m_data.empty(); }
+
+    size_t getMemoryUsage() const { return sizeof(NibbleArray) + m_data.capacity(); }
+
+    // A uniform array is stored as just its fill value
+    void serialize(ByteWriter& writer) const
+    {
+        writer.write(static_cast<uint8_t>(m_data.empty() ? m_fill : 0xFF));
+        writer.writeBytes(m_data.data(), m_data.size());
+    }
+
+    void deserialize(ByteReader& reader)
+    {
+        uint8_t fill = reader.read<uint8_t>();
+        if (fill != 0xFF)
+        {
+            this->fill(fill & 15);
+            return;
+        }
+
+        m_data.resize(BYTES);
+        reader.readBytes(m_data.data(), BYTES);
+    }
+};
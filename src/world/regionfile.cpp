@@ -0,0 +1,323 @@
+#include "regionfile.h"
+#include "../io/bytebuffer.h"
+#include "../io/filesystem.h"
+#include "../utility/checksum.h"
+#include <stb_image.h>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+// Compiled in along with the PNG writer, stb_image_write.h doesn't declare it itself
+extern "C" unsigned char* stbi_zlib_compress(unsigned char* data, int dataLength, int* outLength, int quality);
+
+namespace
+{
+    enum Compression : uint8_t
+    {
+        COMPRESSION_NONE = 0,
+        COMPRESSION_ZLIB = 1
+    };
+
+    // storedSize, rawSize, crc32 of the stored bytes, compression
+    constexpr size_t RECORD_HEADER_BYTES = 4 + 4 + 4 + 1;
+
+    // Far above any real chunk, only there so a damaged header can't request gigabytes
+    constexpr uint32_t MAX_CHUNK_BYTES = 16 << 20;
+
+    constexpr int COMPRESSION_QUALITY = 5;
+
+    uint32_t sectorsFor(size_t bytes)
+    {
+        return static_cast<uint32_t>((bytes + RegionFile::SECTOR_BYTES - 1) / RegionFile::SECTOR_BYTES);
+    }
+}
+
+RegionFile::~RegionFile()
+{
+    close();
+}
+
+bool RegionFile::open(const std::string& path, bool create)
+{
+    close();
+    m_path = path;
+
+    if (!FileSystem::exists(path))
+    {
+        if (!create)
+        {
+            return false;
+        }
+
+        std::ofstream create(path, std::ios::binary);
+        std::vector<char> header(HEADER_SECTORS * SECTOR_BYTES, 0);
+        create.write(header.data(), header.size());
+
+        if (!create)
+        {
+            std::cout << "[ERROR] Could not create region file " << path << std::endl;
+            return false;
+        }
+    }
+
+    m_file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+    if (!m_file.is_open())
+    {
+        std::cout << "[ERROR] Could not open region file " << path << std::endl;
+        return false;
+    }
+
+    m_file.seekg(0, std::ios::end);
+    size_t size = static_cast<size_t>(m_file.tellg());
+    m_file.seekg(0);
+    m_file.read(reinterpret_cast<char*>(m_entries), sizeof(m_entries));
+
+    if (!m_file || size < HEADER_SECTORS * SECTOR_BYTES)
+    {
+        std::cout << "[ERROR] Region file " << path << " has a truncated header" << std::endl;
+        close();
+        return false;
+    }
+
+    m_sectorCount = sectorsFor(size);
+    m_usedSectors = HEADER_SECTORS;
+
+    for (int i = 0; i < CHUNK_COUNT; ++i)
+    {
+        Entry& entry = m_entries[i];
+        if (entry.sectorCount == 0)
+        {
+            continue;
+        }
+
+        if (entry.sector < HEADER_SECTORS || entry.sector > m_sectorCount || entry.sectorCount > m_sectorCount - entry.sector)
+        {
+            std::cout << "[WARNING] Region file " << path << " points chunk " << i << " outside the file, dropping it" << std::endl;
+            entry = {};
+            continue;
+        }
+
+        m_usedSectors += entry.sectorCount;
+    }
+
+    return true;
+}
+
+void RegionFile::close()
+{
+    if (m_file.is_open())
+    {
+        m_file.close();
+    }
+
+    std::fill(std::begin(m_entries), std::end(m_entries), Entry {});
+    m_sectorCount = m_usedSectors = HEADER_SECTORS;
+}
+
+RegionFile::ReadResult RegionFile::read(int localX, int localZ, std::vector<uint8_t>& data)
+{
+    const Entry& entry = m_entries[toIndex(localX, localZ)];
+    if (entry.sectorCount == 0)
+    {
+        return READ_MISSING;
+    }
+
+    uint8_t header[RECORD_HEADER_BYTES];
+    m_file.clear();
+    m_file.seekg(static_cast<std::streamoff>(entry.sector) * SECTOR_BYTES);
+    m_file.read(reinterpret_cast<char*>(header), sizeof(header));
+
+    ByteReader reader(header, sizeof(header));
+    uint32_t storedSize = reader.read<uint32_t>();
+    uint32_t rawSize = reader.read<uint32_t>();
+    uint32_t crc = reader.read<uint32_t>();
+    uint8_t compression = reader.read<uint8_t>();
+
+    if (!m_file || storedSize + RECORD_HEADER_BYTES > static_cast<size_t>(entry.sectorCount) * SECTOR_BYTES || rawSize > MAX_CHUNK_BYTES)
+    {
+        return READ_CORRUPT;
+    }
+
+    m_buffer.resize(storedSize);
+    m_file.read(reinterpret_cast<char*>(m_buffer.data()), storedSize);
+
+    if (!m_file || Checksum::crc32(m_buffer.data(), storedSize) != crc)
+    {
+        return READ_CORRUPT;
+    }
+
+    if (compression == COMPRESSION_NONE && storedSize == rawSize)
+    {
+        data.assign(m_buffer.begin(), m_buffer.end());
+        return READ_OK;
+    }
+
+    if (compression == COMPRESSION_ZLIB)
+    {
+        data.resize(rawSize);
+        int decoded = stbi_zlib_decode_buffer(reinterpret_cast<char*>(data.data()), static_cast<int>(rawSize),
+            reinterpret_cast<const char*>(m_buffer.data()), static_cast<int>(storedSize));
+
+        if (decoded == static_cast<int>(rawSize))
+        {
+            return READ_OK;
+        }
+    }
+
+    return READ_CORRUPT;
+}
+
+size_t RegionFile::write(int localX, int localZ, const uint8_t* data, size_t size)
+{
+    if (size > MAX_CHUNK_BYTES)
+    {
+        std::cout << "[ERROR] Chunk payload of " << size << " bytes is too large for a region file" << std::endl;
+        return 0;
+    }
+
+    int compressedSize = 0;
+    unsigned char* compressed = stbi_zlib_compress(const_cast<uint8_t*>(data), static_cast<int>(size), &compressedSize, COMPRESSION_QUALITY);
+
+    // Incompressible payloads are kept as they are
+    bool useCompressed = compressed && static_cast<size_t>(compressedSize) < size;
+    const uint8_t* stored = useCompressed ? compressed : data;
+    uint32_t storedSize = useCompressed ? static_cast<uint32_t>(compressedSize) : static_cast<uint32_t>(size);
+
+    m_buffer.clear();
+    ByteWriter writer(m_buffer);
+    writer.write(storedSize);
+    writer.write(static_cast<uint32_t>(size));
+    writer.write(Checksum::crc32(stored, storedSize));
+    writer.write(static_cast<uint8_t>(useCompressed ? COMPRESSION_ZLIB : COMPRESSION_NONE));
+    writer.writeBytes(stored, storedSize);
+
+    free(compressed);
+
+    int index = toIndex(localX, localZ);
+    Entry& entry = m_entries[index];
+    uint32_t sectors = sectorsFor(m_buffer.size());
+
+    // Shrinking in place leaves the tail as a hole, growing moves the chunk to the end of the file
+    Entry placed = { entry.sector, sectors };
+    if (entry.sectorCount < sectors)
+    {
+        placed.sector = m_sectorCount;
+    }
+
+    m_buffer.resize(static_cast<size_t>(sectors) * SECTOR_BYTES, 0);
+
+    // The record goes down before the table points at it, so an interrupted write at worst loses this update
+    if (!writeRecord(placed.sector, m_buffer.data(), m_buffer.size()))
+    {
+        return 0;
+    }
+
+    m_sectorCount = std::max(m_sectorCount, placed.sector + sectors);
+    m_usedSectors += sectors - entry.sectorCount;
+    entry = placed;
+
+    if (!writeEntry(index))
+    {
+        return 0;
+    }
+
+    return m_buffer.size();
+}
+
+bool RegionFile::remove(int localX, int localZ)
+{
+    int index = toIndex(localX, localZ);
+    Entry& entry = m_entries[index];
+    if (entry.sectorCount == 0)
+    {
+        return true;
+    }
+
+    m_usedSectors -= entry.sectorCount;
+    entry = {};
+    return writeEntry(index);
+}
+
+bool RegionFile::compact()
+{
+    std::string tempPath = m_path + ".tmp";
+    std::ofstream temp(tempPath, std::ios::binary | std::ios::trunc);
+
+    std::vector<char> header(HEADER_SECTORS * SECTOR_BYTES, 0);
+    temp.write(header.data(), header.size());
+
+    Entry packed[CHUNK_COUNT] = {};
+    uint32_t next = HEADER_SECTORS;
+
+    // Chunks are copied byte for byte in file order, nothing is decompressed
+    std::vector<int> order;
+    for (int i = 0; i < CHUNK_COUNT; ++i)
+    {
+        if (m_entries[i].sectorCount != 0)
+        {
+            order.push_back(i);
+        }
+    }
+    std::sort(order.begin(), order.end(), [this](int a, int b) { return m_entries[a].sector < m_entries[b].sector; });
+
+    for (int index : order)
+    {
+        const Entry& entry = m_entries[index];
+        m_buffer.resize(static_cast<size_t>(entry.sectorCount) * SECTOR_BYTES);
+
+        m_file.clear();
+        m_file.seekg(static_cast<std::streamoff>(entry.sector) * SECTOR_BYTES);
+        m_file.read(reinterpret_cast<char*>(m_buffer.data()), m_buffer.size());
+        temp.write(reinterpret_cast<const char*>(m_buffer.data()), m_buffer.size());
+
+        packed[index] = { next, entry.sectorCount };
+        next += entry.sectorCount;
+    }
+
+    temp.seekp(0);
+    temp.write(reinterpret_cast<const char*>(packed), sizeof(packed));
+    temp.close();
+
+    if (!m_file || !temp)
+    {
+        std::cout << "[ERROR] Failed to compact region file " << m_path << std::endl;
+        FileSystem::remove(tempPath);
+        return false;
+    }
+
+    std::string path = m_path;
+    close();
+    FileSystem::rename(tempPath, path);
+    return open(path);
+}
+
+bool RegionFile::writeEntry(int index)
+{
+    m_file.clear();
+    m_file.seekp(static_cast<std::streamoff>(index) * sizeof(Entry));
+    m_file.write(reinterpret_cast<const char*>(&m_entries[index]), sizeof(Entry));
+    m_file.flush();
+
+    if (!m_file)
+    {
+        std::cout << "[ERROR] Failed to update the table of region file " << m_path << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool RegionFile::writeRecord(uint32_t sector, const uint8_t* record, size_t size)
+{
+    m_file.clear();
+    m_file.seekp(static_cast<std::streamoff>(sector) * SECTOR_BYTES);
+    m_file.write(reinterpret_cast<const char*>(record), size);
+
+    if (!m_file)
+    {
+        std::cout << "[ERROR] Failed to write to region file " << m_path << std::endl;
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <cstddef>
+
+// A file holding up to 32x32 chunks. The first sectors are a table of {sector, sector count} per
+// chunk, each chunk is a checksummed, compressed payload starting on a sector boundary.
+// Rewrites that still fit stay in place, anything larger is appended and the hole it leaves is
+// reclaimed by compact() once enough of the file is dead space
+class RegionFile
+{
+public:
+    static constexpr int SIZE = 32;
+    static constexpr int CHUNK_COUNT = SIZE * SIZE;
+    static constexpr size_t SECTOR_BYTES = 4096;
+
+    enum ReadResult
+    {
+        READ_OK,
+        READ_MISSING,
+        READ_CORRUPT
+    };
+
+private:
+    struct Entry
+    {
+        uint32_t sector;
+        uint32_t sectorCount;
+    };
+
+    static constexpr uint32_t HEADER_SECTORS = static_cast<uint32_t>((CHUNK_COUNT * sizeof(Entry) + SECTOR_BYTES - 1) / SECTOR_BYTES);
+
+    std::string m_path;
+    std::fstream m_file;
+
+    Entry m_entries[CHUNK_COUNT] = {};
+
+    uint32_t m_sectorCount = HEADER_SECTORS;
+    uint32_t m_usedSectors = HEADER_SECTORS;
+
+    std::vector<uint8_t> m_buffer;
+
+    static int toIndex(int localX, int localZ) { return (localZ << 5) | localX; }
+
+    bool writeEntry(int index);
+
+    bool writeRecord(uint32_t sector, const uint8_t* record, size_t size);
+
+public:
+    RegionFile() = default;
+
+    ~RegionFile();
+
+    RegionFile(const RegionFile& other) = delete;
+
+    RegionFile& operator=(const RegionFile& other) = delete;
+
+    // Opens the file. A missing file is created as an empty region, or without create just returns
+    // false, which is what readers want so they don't leave empty files behind
+    bool open(const std::string& path, bool create = true);
+
+    void close();
+
+    bool isOpen() const { return m_file.is_open(); }
+
+    bool hasChunk(int localX, int localZ) const { return m_entries[toIndex(localX, localZ)].sectorCount != 0; }
+
+    ReadResult read(int localX, int localZ, std::vector<uint8_t>& data);
+
+    // Compresses the payload and stores it, returns the number of bytes written to disk or 0 on failure
+    size_t write(int localX, int localZ, const uint8_t* data, size_t size);
+
+    bool remove(int localX, int localZ);
+
+    // Rewrites the file with chunks packed back to back, dropping every hole
+    bool compact();
+
+    // True once more than half of a non-trivial file is unreferenced sectors
+    bool shouldCompact() const { return m_sectorCount > 64 && m_sectorCount - m_usedSectors > m_usedSectors; }
+
+    size_t getFileSize() const { return static_cast<size_t>(m_sectorCount) * SECTOR_BYTES; }
+
+    size_t getUsedSize() const { return static_cast<size_t>(m_usedSectors) * SECTOR_BYTES; }
+};
@@ -0,0 +1,292 @@
+#include "regionstorage.h"
+#include "../io/filesystem.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+using Clock = std::chrono::high_resolution_clock;
+
+static double elapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+RegionStorage::RegionStorage(const std::string& directory, size_t maxOpenRegions)
+    : m_directory(directory), m_maxOpenRegions(std::max<size_t>(1, maxOpenRegions))
+{
+    if (!FileSystem::exists(directory))
+    {
+        FileSystem::createFullDirectory(directory);
+    }
+
+    m_thread = std::thread(&RegionStorage::threadLoop, this);
+}
+
+RegionStorage::~RegionStorage()
+{
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_requestAvailable.notify_all();
+
+    m_thread.join();
+}
+
+void RegionStorage::save(const Chunk& chunk)
+{
+    PendingSave save;
+    chunk.serialize(save.payload);
+
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        queueSave(chunk.getX(), chunk.getZ(), std::move(save));
+    }
+    m_requestAvailable.notify_one();
+}
+
+void RegionStorage::save(ScopedPtr<Chunk::Snapshot> snapshot)
+{
+    int chunkX = snapshot->x;
+    int chunkZ = snapshot->z;
+
+    PendingSave save;
+    save.snapshot = std::move(snapshot);
+
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        queueSave(chunkX, chunkZ, std::move(save));
+    }
+    m_requestAvailable.notify_one();
+}
+
+void RegionStorage::queueSave(int chunkX, int chunkZ, PendingSave save)
+{
+    m_pendingSnapshots += save.snapshot != nullptr;
+
+    auto inserted = m_pendingSaves.emplace(toKey(chunkX, chunkZ), PendingSave());
+    PendingSave& pending = inserted.first->second;
+
+    m_pendingSnapshots -= pending.snapshot != nullptr;
+    pending = std::move(save);
+
+    if (inserted.second)
+    {
+        m_requests.push_back({ REQUEST_SAVE, chunkX, chunkZ });
+    }
+}
+
+void RegionStorage::load(int chunkX, int chunkZ)
+{
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_requests.push_back({ REQUEST_LOAD, chunkX, chunkZ });
+    }
+    m_requestAvailable.notify_one();
+}
+
+size_t RegionStorage::poll(const LoadCallback& callback)
+{
+    std::vector<Result> results;
+
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        results.swap(m_results);
+    }
+
+    for (Result& result : results)
+    {
+        callback(result.chunkX, result.chunkZ, std::move(result.chunk));
+    }
+
+    return results.size();
+}
+
+size_t RegionStorage::pollFailedSaves(const SaveFailedCallback& callback)
+{
+    std::vector<Vec2<int>> failed;
+
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        failed.swap(m_failedSaves);
+    }
+
+    for (const Vec2<int>& chunk : failed)
+    {
+        callback(chunk.x, chunk.y);
+    }
+
+    return failed.size();
+}
+
+void RegionStorage::flush()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this] { return m_requests.empty() && !m_busy; });
+}
+
+RegionStorage::Stats RegionStorage::getStats()
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+
+    Stats stats = m_stats;
+    stats.queued = m_requests.size();
+    stats.snapshots = m_pendingSnapshots;
+    return stats;
+}
+
+void RegionStorage::threadLoop()
+{
+    while (true)
+    {
+        Request request;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_requestAvailable.wait(lock, [this] { return m_stopping || !m_requests.empty(); });
+
+            if (m_requests.empty())
+            {
+                break;
+            }
+
+            request = m_requests.front();
+            m_requests.pop_front();
+            m_busy = true;
+        }
+
+        process(request);
+
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            m_busy = false;
+            if (m_requests.empty())
+            {
+                m_idle.notify_all();
+            }
+        }
+    }
+
+    m_regions.clear();
+}
+
+void RegionStorage::process(const Request& request)
+{
+    auto start = Clock::now();
+
+    int regionX = request.chunkX >> 5;
+    int regionZ = request.chunkZ >> 5;
+    int localX = request.chunkX & (RegionFile::SIZE - 1);
+    int localZ = request.chunkZ & (RegionFile::SIZE - 1);
+
+    // Loading somewhere that was never saved must not leave an empty region file behind
+    RegionFile* region = getRegion(regionX, regionZ, request.type == REQUEST_SAVE);
+
+    if (request.type == REQUEST_SAVE)
+    {
+        PendingSave save;
+
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_pendingSaves.find(toKey(request.chunkX, request.chunkZ));
+            save = std::move(it->second);
+            m_pendingSaves.erase(it);
+        }
+
+        m_payload = std::move(save.payload);
+
+        bool wasSnapshot = save.snapshot != nullptr;
+        if (wasSnapshot)
+        {
+            m_payload.clear();
+            save.snapshot->serialize(m_payload);
+            save.snapshot.reset();
+        }
+
+        size_t written = region ? region->write(localX, localZ, m_payload.data(), m_payload.size()) : 0;
+
+        bool compacted = false;
+        if (written && region->shouldCompact())
+        {
+            compacted = region->compact();
+        }
+
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_pendingSnapshots -= wasSnapshot;
+        m_stats.saved += written != 0;
+        m_stats.failed += written == 0;
+        if (written == 0)
+        {
+            m_failedSaves.push_back({ request.chunkX, request.chunkZ });
+        }
+        m_stats.compactions += compacted;
+        m_stats.bytesWritten += written;
+        m_stats.writeMs += elapsedMs(start);
+        m_stats.openRegions = m_regions.size();
+        return;
+    }
+
+    RegionFile::ReadResult read = region ? region->read(localX, localZ, m_payload) : RegionFile::READ_MISSING;
+
+    ScopedPtr<Chunk> chunk;
+    if (read == RegionFile::READ_OK)
+    {
+        chunk = MakeScoped<Chunk>(request.chunkX, request.chunkZ);
+        if (!chunk->deserialize(m_payload.data(), m_payload.size()))
+        {
+            chunk.reset();
+            read = RegionFile::READ_CORRUPT;
+        }
+    }
+
+    if (read == RegionFile::READ_CORRUPT)
+    {
+        std::cout << "[WARNING] Chunk " << request.chunkX << ", " << request.chunkZ << " is corrupt and will be regenerated" << std::endl;
+    }
+
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    m_results.push_back({ request.chunkX, request.chunkZ, std::move(chunk) });
+    m_stats.loaded += read == RegionFile::READ_OK;
+    m_stats.missing += read == RegionFile::READ_MISSING;
+    m_stats.failed += read == RegionFile::READ_CORRUPT;
+    m_stats.bytesRead += read == RegionFile::READ_OK ? m_payload.size() : 0;
+    m_stats.readMs += elapsedMs(start);
+    m_stats.openRegions = m_regions.size();
+}
+
+RegionFile* RegionStorage::getRegion(int regionX, int regionZ, bool create)
+{
+    ++m_useCounter;
+
+    for (OpenRegion& region : m_regions)
+    {
+        if (region.regionX == regionX && region.regionZ == regionZ)
+        {
+            region.lastUse = m_useCounter;
+            return region.file.get();
+        }
+    }
+
+    // Checked before evicting anything to make room
+    std::string path = (FileSystem::Path(m_directory) / ("r." + std::to_string(regionX) + "." + std::to_string(regionZ) + ".region")).string();
+    if (!create && !FileSystem::exists(path))
+    {
+        return nullptr;
+    }
+
+    if (m_regions.size() >= m_maxOpenRegions)
+    {
+        auto oldest = std::min_element(m_regions.begin(), m_regions.end(),
+            [](const OpenRegion& a, const OpenRegion& b) { return a.lastUse < b.lastUse; });
+        m_regions.erase(oldest);
+    }
+
+    auto file = MakeScoped<RegionFile>();
+    if (!file->open(path, create))
+    {
+        return nullptr;
+    }
+
+    m_regions.push_back({ regionX, regionZ, m_useCounter, std::move(file) });
+    return m_regions.back().file.get();
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+#include "chunk.h"
+#include "regionfile.h"
+#include "../memory/pointers.h"
+#include "../utility/vec.h"
+
+// Saves and loads chunks through region files on a dedicated I/O thread. Chunks are serialized on
+// the calling thread so the caller can keep editing them, compression and disk access happen on the
+// I/O thread, and loaded chunks are handed back through poll() on whichever thread owns the world
+class RegionStorage
+{
+public:
+    // chunk is null if nothing was saved there or the stored data failed its checksum
+    using LoadCallback = std::function<void(int chunkX, int chunkZ, ScopedPtr<Chunk> chunk)>;
+
+    using SaveFailedCallback = std::function<void(int chunkX, int chunkZ)>;
+
+    struct Stats
+    {
+        size_t queued = 0;
+
+        // Snapshot saves not written yet
+        size_t snapshots = 0;
+
+        size_t saved = 0;
+        size_t loaded = 0;
+        size_t missing = 0;
+        size_t failed = 0;
+        size_t compactions = 0;
+        size_t bytesWritten = 0;
+        size_t bytesRead = 0;
+        size_t openRegions = 0;
+        double writeMs = 0.0;
+        double readMs = 0.0;
+    };
+
+private:
+    enum RequestType
+    {
+        REQUEST_SAVE,
+        REQUEST_LOAD
+    };
+
+    struct Request
+    {
+        RequestType type;
+        int chunkX;
+        int chunkZ;
+    };
+
+    // Either an already serialized payload or a snapshot the I/O thread serializes itself
+    struct PendingSave
+    {
+        std::vector<uint8_t> payload;
+        ScopedPtr<Chunk::Snapshot> snapshot;
+    };
+
+    struct Result
+    {
+        int chunkX;
+        int chunkZ;
+        ScopedPtr<Chunk> chunk;
+    };
+
+    struct OpenRegion
+    {
+        int regionX;
+        int regionZ;
+        uint64_t lastUse;
+        ScopedPtr<RegionFile> file;
+    };
+
+    std::string m_directory;
+    size_t m_maxOpenRegions;
+
+    std::mutex m_mutex;
+    std::condition_variable m_requestAvailable;
+    std::condition_variable m_idle;
+
+    std::deque<Request> m_requests;
+
+    // Latest serialized payload per chunk. Saving a chunk again before the I/O thread got to it
+    // just replaces the payload instead of writing twice
+    std::unordered_map<uint64_t, PendingSave> m_pendingSaves;
+    size_t m_pendingSnapshots = 0;
+
+    std::vector<Result> m_results;
+    std::vector<Vec2<int>> m_failedSaves;
+    Stats m_stats;
+    bool m_busy = false;
+    bool m_stopping = false;
+
+    // Only touched by the I/O thread
+    std::vector<OpenRegion> m_regions;
+    uint64_t m_useCounter = 0;
+    std::vector<uint8_t> m_payload;
+
+    std::thread m_thread;
+
+    static uint64_t toKey(int chunkX, int chunkZ)
+    {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(chunkX)) << 32) | static_cast<uint32_t>(chunkZ);
+    }
+
+    void threadLoop();
+
+    void process(const Request& request);
+
+    // Expects the lock to be held
+    void queueSave(int chunkX, int chunkZ, PendingSave save);
+
+    // Null if the region can't be opened, or without create if it has no file yet
+    RegionFile* getRegion(int regionX, int regionZ, bool create);
+
+public:
+    // maxOpenRegions bounds the file handles kept around, the least recently used region is closed first
+    RegionStorage(const std::string& directory, size_t maxOpenRegions = 16);
+
+    // Finishes every queued request before returning
+    ~RegionStorage();
+
+    RegionStorage(const RegionStorage& other) = delete;
+
+    RegionStorage& operator=(const RegionStorage& other) = delete;
+
+    void save(const Chunk& chunk);
+
+    // Serializes on the I/O thread. The snapshot's sections are released as soon as they're
+    // serialized, which is what lets the chunk stop copying them on write
+    void save(ScopedPtr<Chunk::Snapshot> snapshot);
+
+    void load(int chunkX, int chunkZ);
+
+    // Delivers finished loads, returns how many were delivered
+    size_t poll(const LoadCallback& callback);
+
+    // Reports chunks whose write failed since the last call, so their owner can keep them marked
+    // as modified and try again later. Returns how many were reported
+    size_t pollFailedSaves(const SaveFailedCallback& callback);
+
+    // Blocks until every queued request has been written or read
+    void flush();
+
+    Stats getStats();
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Section coordinate: chunk x, section index up the column, chunk z
+struct SectionPos
+{
+    int x = 0;
+    int y = 0;
+    int z = 0;
+
+    bool operator==(const SectionPos& other) const
+    {
+        return x == other.x && y == other.y && z == other.z;
+    }
+
+    bool operator!=(const SectionPos& other) const
+    {
+        return !(*this == other);
+    }
+};
+
+namespace std
+{
+    template<>
+    struct hash<SectionPos>
+    {
+        size_t operator()(const SectionPos& pos) const
+        {
+            uint64_t h = static_cast<uint32_t>(pos.x) * 0x9E3779B97F4A7C15ull;
+            h ^= (static_cast<uint32_t>(pos.z) + 0x632BE59BD9B4E019ull + (h << 6) + (h >> 2)) * 0x94D049BB133111EBull;
+            h ^= static_cast<uint32_t>(pos.y) + (h >> 29);
+            return static_cast<size_t>(h);
+        }
+    };
+}
@@ -0,0 +1,698 @@
+#include "terraingenerator.h"
+#include "../render/frustum.h"
+#include "../physics/aabb.h"
+#include "../utility/random.h"
+#include <queue>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+
+using Clock = std::chrono::high_resolution_clock;
+
+static double elapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+namespace
+{
+    // How far out a stage reads or writes. A stage needs every chunk in its radius at the stage
+    // before, and they all stay locked until it finishes
+    constexpr int STAGE_RADIUS[TerrainGenerator::STAGE_COUNT] = { 0, 0, 1, 0, 1 };
+
+    // Required level for chunks that get handed out
+    constexpr int STAGE_DELIVER = TerrainGenerator::STAGE_COUNT;
+
+    // Chunks whose caves can reach into a chunk
+    constexpr int CARVER_RANGE = 3;
+
+    // Density is sampled on a coarse grid and interpolated in between
+    constexpr int CELL_WIDTH = 4;
+    constexpr int CELL_HEIGHT = 8;
+    constexpr int GRID_WIDTH = Chunk::SIZE / CELL_WIDTH + 1;
+    constexpr int GRID_HEIGHT = Chunk::HEIGHT / CELL_HEIGHT + 1;
+
+    // The 3x3 chunks around a job's own chunk, null where a chunk was already handed out
+    struct Footprint
+    {
+        Chunk* chunks[9] = {};
+        const uint16_t* heights[9] = {};
+
+        Chunk& centre() const { return *chunks[4]; }
+
+        static int toIndex(int dx, int dz) { return (dz + 1) * 3 + dx + 1; }
+
+        // Local coordinates relative to the centre chunk, may be up to one chunk outside it
+        void setBlock(int x, int y, int z, BlockId block, bool replaceAny) const
+        {
+            int dx = (x >> 4), dz = (z >> 4);
+            Chunk* chunk = chunks[toIndex(dx, dz)];
+            if (chunk && (replaceAny || chunk->getBlock(x & 15, y, z & 15) == BLOCK_AIR))
+            {
+                chunk->setBlock(x & 15, y, z & 15, block);
+            }
+        }
+
+        int getHeight(int x, int z) const
+        {
+            const uint16_t* column = heights[toIndex(x >> 4, z >> 4)];
+            return column ? column[((z & 15) << 4) | (x & 15)] : heights[4][(std::clamp(z, 0, 15) << 4) | std::clamp(x, 0, 15)];
+        }
+    };
+
+    bool generateNoise(const TerrainGenerator::Settings& settings, const Noise& heightNoise, const Noise& detailNoise, const Footprint& footprint, uint16_t* heights, const std::atomic<bool>& cancel)
+    {
+        Chunk& chunk = footprint.centre();
+        float baseX = static_cast<float>(chunk.getX() * Chunk::SIZE);
+        float baseZ = static_cast<float>(chunk.getZ() * Chunk::SIZE);
+
+        float surface[GRID_WIDTH][GRID_WIDTH];
+        heightNoise.fillGrid(&surface[0][0], Vec2<float>{ baseX, baseZ }, Vec2<int>{ GRID_WIDTH, GRID_WIDTH }, Vec2<float>{ CELL_WIDTH, CELL_WIDTH });
+
+        // Sampled further apart vertically than the cells are tall, which stretches features upwards
+        float density[GRID_HEIGHT][GRID_WIDTH][GRID_WIDTH];
+        detailNoise.fillGrid(&density[0][0][0], Vec3<float>{ baseX, 0.0f, baseZ }, Vec3<int>{ GRID_WIDTH, GRID_HEIGHT, GRID_WIDTH }, Vec3<float>{ CELL_WIDTH, CELL_HEIGHT * 1.6f, CELL_WIDTH });
+
+        for (int gy = 0; gy < GRID_HEIGHT; ++gy)
+        {
+            float y = static_cast<float>(gy * CELL_HEIGHT);
+            for (int gz = 0; gz < GRID_WIDTH; ++gz)
+            {
+                for (int gx = 0; gx < GRID_WIDTH; ++gx)
+                {
+                    float top = settings.baseHeight + 28.0f * surface[gz][gx];
+                    density[gy][gz][gx] = (top - y) / 20.0f + 0.6f * density[gy][gz][gx];
+                }
+            }
+        }
+
+        std::fill_n(heights, Chunk::SIZE * Chunk::SIZE, static_cast<uint16_t>(0));
+
+        for (int y = 0; y < Chunk::HEIGHT; ++y)
+        {
+            if ((y & 15) == 0 && cancel.load(std::memory_order_relaxed))
+            {
+                return false;
+            }
+
+            int gy = y / CELL_HEIGHT;
+            float ty = static_cast<float>(y % CELL_HEIGHT) / CELL_HEIGHT;
+
+            for (int z = 0; z < Chunk::SIZE; ++z)
+            {
+                int gz = z / CELL_WIDTH;
+                float tz = static_cast<float>(z % CELL_WIDTH) / CELL_WIDTH;
+
+                for (int x = 0; x < Chunk::SIZE; ++x)
+                {
+                    int gx = x / CELL_WIDTH;
+                    float tx = static_cast<float>(x % CELL_WIDTH) / CELL_WIDTH;
+
+                    auto lerpX = [&](int oy, int oz)
+                    {
+                        float a = density[gy + oy][gz + oz][gx];
+                        return a + (density[gy + oy][gz + oz][gx + 1] - a) * tx;
+                    };
+
+                    float d0 = lerpX(0, 0) + (lerpX(1, 0) - lerpX(0, 0)) * ty;
+                    float d1 = lerpX(0, 1) + (lerpX(1, 1) - lerpX(0, 1)) * ty;
+                    float value = d0 + (d1 - d0) * tz;
+
+                    if (value > 0.0f)
+                    {
+                        chunk.setBlock(x, y, z, settings.stone);
+                        heights[(z << 4) | x] = static_cast<uint16_t>(y);
+                    }
+                    else if (y <= settings.seaLevel)
+                    {
+                        chunk.setBlock(x, y, z, settings.water);
+                    }
+                }
+            }
+        }
+
+        return true;
+    }
+
+    bool generateSurface(const TerrainGenerator::Settings& settings, const Footprint& footprint, const std::atomic<bool>& cancel)
+    {
+        if (cancel.load(std::memory_order_relaxed))
+        {
+            return false;
+        }
+
+        Chunk& chunk = footprint.centre();
+
+        for (int z = 0; z < Chunk::SIZE; ++z)
+        {
+            for (int x = 0; x < Chunk::SIZE; ++x)
+            {
+                int top = footprint.getHeight(x, z);
+                if (top == 0)
+                {
+                    continue;
+                }
+
+                // Columns along the border compare against the neighbouring chunk's heights
+                int slope = std::max({ std::abs(top - footprint.getHeight(x - 1, z)), std::abs(top - footprint.getHeight(x + 1, z)),
+                    std::abs(top - footprint.getHeight(x, z - 1)), std::abs(top - footprint.getHeight(x, z + 1)) });
+
+                BlockId cover, filler;
+                if (top <= settings.seaLevel + 1)
+                {
+                    cover = filler = settings.sand;
+                }
+                else if (slope >= 3)
+                {
+                    continue;
+                }
+                else
+                {
+                    cover = settings.grass;
+                    filler = settings.dirt;
+                }
+
+                for (int y = top; y > top - 4 && y > 0; --y)
+                {
+                    if (chunk.getBlock(x, y, z) == settings.stone)
+                    {
+                        chunk.setBlock(x, y, z, y == top ? cover : filler);
+                    }
+                }
+            }
+        }
+
+        return true;
+    }
+
+    bool generateCaves(const TerrainGenerator::Settings& settings, const Footprint& footprint, const std::atomic<bool>& cancel)
+    {
+        Chunk& chunk = footprint.centre();
+        double minX = chunk.getX() * Chunk::SIZE, minZ = chunk.getZ() * Chunk::SIZE;
+        double maxX = minX + Chunk::SIZE, maxZ = minZ + Chunk::SIZE;
+
+        for (int sourceZ = chunk.getZ() - CARVER_RANGE; sourceZ <= chunk.getZ() + CARVER_RANGE; ++sourceZ)
+        {
+            if (cancel.load(std::memory_order_relaxed))
+            {
+                return false;
+            }
+
+            for (int sourceX = chunk.getX() - CARVER_RANGE; sourceX <= chunk.getX() + CARVER_RANGE; ++sourceX)
+            {
+                Random random(Random::getCarverSeed(static_cast<int64_t>(settings.seed), sourceX, sourceZ));
+                if (random.nextInt(5) != 0)
+                {
+                    continue;
+                }
+
+                double x = sourceX * Chunk::SIZE + random.nextDouble() * Chunk::SIZE;
+                double y = 12.0 + random.nextDouble() * 56.0;
+                double z = sourceZ * Chunk::SIZE + random.nextDouble() * Chunk::SIZE;
+                double yaw = random.nextDouble() * 6.283185307179586;
+                double pitch = (random.nextDouble() - 0.5) * 0.5;
+                int length = 60 + random.nextInt(60);
+
+                for (int step = 0; step < length; ++step)
+                {
+                    double radius = 1.5 + 2.0 * std::sin(step * 3.141592653589793 / length);
+
+                    x += std::cos(yaw) * std::cos(pitch);
+                    y += std::sin(pitch);
+                    z += std::sin(yaw) * std::cos(pitch);
+                    yaw += (random.nextDouble() - 0.5) * 0.4;
+                    pitch = pitch * 0.8 + (random.nextDouble() - 0.5) * 0.3;
+
+                    if (x + radius < minX || x - radius >= maxX || z + radius < minZ || z - radius >= maxZ)
+                    {
+                        continue;
+                    }
+
+                    int x0 = std::max(static_cast<int>(std::floor(x - radius)), static_cast<int>(minX));
+                    int x1 = std::min(static_cast<int>(std::floor(x + radius)), static_cast<int>(maxX) - 1);
+                    int z0 = std::max(static_cast<int>(std::floor(z - radius)), static_cast<int>(minZ));
+                    int z1 = std::min(static_cast<int>(std::floor(z + radius)), static_cast<int>(maxZ) - 1);
+                    int y0 = std::max(static_cast<int>(std::floor(y - radius)), 1);
+                    int y1 = std::min(static_cast<int>(std::floor(y + radius)), Chunk::HEIGHT - 1);
+
+                    for (int by = y0; by <= y1; ++by)
+                    {
+                        for (int bz = z0; bz <= z1; ++bz)
+                        {
+                            for (int bx = x0; bx <= x1; ++bx)
+                            {
+                                double dx = bx + 0.5 - x, dy = by + 0.5 - y, dz = bz + 0.5 - z;
+                                if (dx * dx + dy * dy + dz * dz > radius * radius)
+                                {
+                                    continue;
+                                }
+
+                                int lx = bx - static_cast<int>(minX), lz = bz - static_cast<int>(minZ);
+                                BlockId block = chunk.getBlock(lx, by, lz);
+
+                                // Keep caves from draining the sea
+                                if (block != settings.water && chunk.getBlock(lx, by + 1, lz) != settings.water)
+                                {
+                                    chunk.setBlock(lx, by, lz, BLOCK_AIR);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        return true;
+    }
+
+    bool generateTrees(const TerrainGenerator::Settings& settings, const Noise& forestNoise, const Footprint& footprint, const std::atomic<bool>& cancel)
+    {
+        if (cancel.load(std::memory_order_relaxed))
+        {
+            return false;
+        }
+
+        Chunk& chunk = footprint.centre();
+        Random random(Random::getPopulationSeed(static_cast<int64_t>(settings.seed), chunk.getX() * Chunk::SIZE, chunk.getZ() * Chunk::SIZE));
+
+        // Sparse woods where this noise is high, open ground elsewhere
+        float forest = forestNoise.get(static_cast<float>(chunk.getX() * Chunk::SIZE), static_cast<float>(chunk.getZ() * Chunk::SIZE));
+        int attempts = forest > 0.1f ? 6 : 1;
+
+        for (int i = 0; i < attempts; ++i)
+        {
+            int x = random.nextInt(Chunk::SIZE);
+            int z = random.nextInt(Chunk::SIZE);
+            int trunk = 4 + random.nextInt(3);
+
+            // The noise stage's height rather than a scan from the top, which could land on a
+            // neighbour's leaves depending on which chunk got decorated first
+            int ground = footprint.getHeight(x, z);
+            if (chunk.getBlock(x, ground, z) != settings.grass || ground + trunk + 2 >= Chunk::HEIGHT)
+            {
+                continue;
+            }
+
+            chunk.setBlock(x, ground, z, settings.dirt);
+
+            int top = ground + trunk;
+            for (int y = top - 2; y <= top + 1; ++y)
+            {
+                int radius = y >= top ? 1 : 2;
+                for (int dz = -radius; dz <= radius; ++dz)
+                {
+                    for (int dx = -radius; dx <= radius; ++dx)
+                    {
+                        if (std::abs(dx) == radius && std::abs(dz) == radius && (y == top + 1 || random.nextBool()))
+                        {
+                            continue;
+                        }
+
+                        // Leaves only fill air and logs win over leaves, so overlapping trees end
+                        // up the same whichever was placed first
+                        footprint.setBlock(x + dx, y, z + dz, settings.leaves, false);
+                    }
+                }
+            }
+
+            for (int y = ground + 1; y <= top; ++y)
+            {
+                BlockId block = chunk.getBlock(x, y, z);
+                if (block == BLOCK_AIR || block == settings.leaves)
+                {
+                    chunk.setBlock(x, y, z, settings.log);
+                }
+            }
+        }
+
+        return true;
+    }
+}
+
+TerrainGenerator::TerrainGenerator(const Settings& settings, ThreadPool& pool, size_t maxInFlight)
+    : m_settings(settings), m_pool(pool), m_maxInFlight(std::max<size_t>(1, maxInFlight)), m_rateStart(std::chrono::steady_clock::now())
+{
+    Random random(static_cast<long long>(settings.seed));
+
+    Noise::Settings height;
+    height.frequency = 1.0f / 256.0f;
+    height.octaves = 4;
+    m_heightNoise = Noise(random, height);
+
+    Noise::Settings detail;
+    detail.frequency = 1.0f / 64.0f;
+    detail.octaves = 3;
+    m_detailNoise = Noise(random, detail);
+
+    Noise::Settings forest;
+    forest.frequency = 1.0f / 128.0f;
+    forest.octaves = 2;
+    m_forestNoise = Noise(random, forest);
+}
+
+TerrainGenerator::~TerrainGenerator()
+{
+    for (auto& entry : m_entries)
+    {
+        entry.second.cancel = true;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_jobDone.wait(lock, [this] { return m_running == 0; });
+}
+
+TerrainGenerator::Entry* TerrainGenerator::find(int chunkX, int chunkZ)
+{
+    auto it = m_entries.find(toKey(chunkX, chunkZ));
+    return it == m_entries.end() ? nullptr : &it->second;
+}
+
+void TerrainGenerator::update(const Vec3<double>& camera, const Frustum* frustum)
+{
+    collectFinished();
+
+    Vec2<int> cameraChunk = { static_cast<int>(std::floor(camera.x / Chunk::SIZE)), static_cast<int>(std::floor(camera.z / Chunk::SIZE)) };
+    if (!m_hasCamera || cameraChunk.x != m_cameraChunk.x || cameraChunk.y != m_cameraChunk.y)
+    {
+        m_cameraChunk = cameraChunk;
+        m_hasCamera = true;
+        updateRequirements();
+    }
+
+    struct Candidate
+    {
+        double priority;
+        Entry* entry;
+
+        bool operator<(const Candidate& other) const { return priority > other.priority; }
+    };
+
+    std::priority_queue<Candidate> queue;
+
+    for (auto& pair : m_entries)
+    {
+        Entry& entry = pair.second;
+        if (entry.busy || entry.delivered)
+        {
+            continue;
+        }
+
+        if (entry.stage == STAGE_DECORATED)
+        {
+            if (entry.required == STAGE_DELIVER && canDeliver(entry))
+            {
+                entry.delivered = true;
+                m_ready.push_back(std::move(entry.chunk));
+                m_stats.generated++;
+                m_rateCount++;
+            }
+            continue;
+        }
+
+        Stage next = static_cast<Stage>(entry.stage + 1);
+        if (entry.required < next || !canRun(entry, next))
+        {
+            continue;
+        }
+
+        double dx = (entry.x + 0.5) * Chunk::SIZE - camera.x;
+        double dz = (entry.z + 0.5) * Chunk::SIZE - camera.z;
+        double priority = dx * dx + dz * dz;
+
+        // Behind the camera counts as twice as far away
+        if (frustum)
+        {
+            AABB bounds = { entry.x * double(Chunk::SIZE), 0.0, entry.z * double(Chunk::SIZE),
+                (entry.x + 1) * double(Chunk::SIZE), double(Chunk::HEIGHT), (entry.z + 1) * double(Chunk::SIZE) };
+            if (!frustum->aabbIn(bounds))
+            {
+                priority *= 4.0;
+            }
+        }
+
+        queue.push({ priority, &entry });
+    }
+
+    m_stats.queueDepth = queue.size();
+
+    while (!queue.empty() && m_inFlight < m_maxInFlight)
+    {
+        Entry& entry = *queue.top().entry;
+        queue.pop();
+
+        // An earlier pick this round may have locked part of the footprint
+        Stage next = static_cast<Stage>(entry.stage + 1);
+        if (canRun(entry, next))
+        {
+            dispatch(entry, next);
+        }
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - m_rateStart).count();
+    if (seconds >= 1.0)
+    {
+        m_stats.chunksPerSecond = m_rateCount / seconds;
+        m_rateCount = 0;
+        m_rateStart = now;
+    }
+
+    m_stats.tracked = m_entries.size();
+    m_stats.inFlight = m_inFlight;
+    m_stats.waiting = m_ready.size();
+}
+
+size_t TerrainGenerator::poll(const ChunkCallback& callback)
+{
+    std::vector<ScopedPtr<Chunk>> ready;
+    ready.swap(m_ready);
+
+    for (ScopedPtr<Chunk>& chunk : ready)
+    {
+        callback(std::move(chunk));
+    }
+
+    m_stats.waiting = 0;
+    return ready.size();
+}
+
+std::string TerrainGenerator::getDebugText() const
+{
+    const char* names[STAGE_COUNT] = { "", "Noise", "Surface", "Carve", "Decorate" };
+
+    char line[128];
+    std::snprintf(line, sizeof(line), "Chunks/s: %.1f\nQueue: %zu  In flight: %zu  Waiting: %zu\nTracked: %zu  Cancelled: %zu\n",
+        m_stats.chunksPerSecond, m_stats.queueDepth, m_stats.inFlight, m_stats.waiting, m_stats.tracked, m_stats.cancelled);
+    std::string text = line;
+
+    for (int stage = STAGE_NOISE; stage < STAGE_COUNT; ++stage)
+    {
+        size_t jobs = m_stats.stageJobs[stage];
+        std::snprintf(line, sizeof(line), "%s: %zu jobs, %.2f ms avg\n", names[stage], jobs, jobs ? m_stats.stageMs[stage] / jobs : 0.0);
+        text += line;
+    }
+
+    return text;
+}
+
+void TerrainGenerator::collectFinished()
+{
+    std::vector<Finished> finished;
+
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        finished.swap(m_finished);
+    }
+
+    for (const Finished& job : finished)
+    {
+        Entry& entry = m_entries.at(job.key);
+        setFootprintBusy(entry, job.stage, false);
+        entry.running = STAGE_EMPTY;
+        m_inFlight--;
+
+        if (job.cancelled)
+        {
+            // The later stages either stop before changing anything or can safely run again over
+            // what they already did, only a half filled noise stage has to start from scratch
+            if (job.stage == STAGE_NOISE)
+            {
+                entry.chunk = MakeScoped<Chunk>(entry.x, entry.z);
+            }
+
+            entry.cancel = false;
+            m_stats.cancelled++;
+            continue;
+        }
+
+        entry.stage = job.stage;
+        m_stats.stageJobs[job.stage]++;
+        m_stats.stageMs[job.stage] += job.ms;
+    }
+
+    // Requirements only drop when the camera moves, entries that were busy then are erased now
+    if (!finished.empty())
+    {
+        for (auto it = m_entries.begin(); it != m_entries.end();)
+        {
+            it = it->second.required == 0 && !it->second.busy ? m_entries.erase(it) : std::next(it);
+        }
+    }
+}
+
+void TerrainGenerator::updateRequirements()
+{
+    int view = std::max(0, m_settings.viewDistance);
+
+    // Each stage needs its neighbours one stage behind, so support shrinks by a stage per ring
+    int reach = view + STAGE_DELIVER - 1;
+
+    for (auto& pair : m_entries)
+    {
+        pair.second.required = 0;
+    }
+
+    for (int z = m_cameraChunk.y - reach; z <= m_cameraChunk.y + reach; ++z)
+    {
+        for (int x = m_cameraChunk.x - reach; x <= m_cameraChunk.x + reach; ++x)
+        {
+            int distance = std::max(std::abs(x - m_cameraChunk.x), std::abs(z - m_cameraChunk.y));
+            Entry& entry = m_entries[toKey(x, z)];
+
+            if (!entry.chunk && !entry.delivered)
+            {
+                entry.x = x;
+                entry.z = z;
+                entry.chunk = MakeScoped<Chunk>(x, z);
+            }
+
+            entry.required = STAGE_DELIVER - std::max(0, distance - view);
+        }
+    }
+
+    for (auto it = m_entries.begin(); it != m_entries.end();)
+    {
+        Entry& entry = it->second;
+
+        if (entry.running != STAGE_EMPTY && entry.running > entry.required)
+        {
+            entry.cancel = true;
+        }
+
+        it = entry.required == 0 && !entry.busy ? m_entries.erase(it) : std::next(it);
+    }
+}
+
+bool TerrainGenerator::canRun(const Entry& entry, Stage stage)
+{
+    int radius = STAGE_RADIUS[stage];
+
+    for (int dz = -radius; dz <= radius; ++dz)
+    {
+        for (int dx = -radius; dx <= radius; ++dx)
+        {
+            const Entry* neighbour = find(entry.x + dx, entry.z + dz);
+            if (!neighbour || neighbour->busy)
+            {
+                return false;
+            }
+
+            if ((dx != 0 || dz != 0) && !neighbour->delivered && neighbour->stage < stage - 1)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool TerrainGenerator::canDeliver(const Entry& entry)
+{
+    // Neighbours decorating later could still put leaves into this chunk
+    for (int dz = -1; dz <= 1; ++dz)
+    {
+        for (int dx = -1; dx <= 1; ++dx)
+        {
+            const Entry* neighbour = find(entry.x + dx, entry.z + dz);
+            if (!neighbour || (!neighbour->delivered && neighbour->stage < STAGE_DECORATED))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void TerrainGenerator::setFootprintBusy(const Entry& entry, Stage stage, bool busy)
+{
+    int radius = STAGE_RADIUS[stage];
+
+    for (int dz = -radius; dz <= radius; ++dz)
+    {
+        for (int dx = -radius; dx <= radius; ++dx)
+        {
+            find(entry.x + dx, entry.z + dz)->busy = busy;
+        }
+    }
+}
+
+void TerrainGenerator::dispatch(Entry& entry, Stage stage)
+{
+    Footprint footprint;
+    int radius = STAGE_RADIUS[stage];
+
+    for (int dz = -radius; dz <= radius; ++dz)
+    {
+        for (int dx = -radius; dx <= radius; ++dx)
+        {
+            Entry* neighbour = find(entry.x + dx, entry.z + dz);
+            footprint.chunks[Footprint::toIndex(dx, dz)] = neighbour->chunk.get();
+            footprint.heights[Footprint::toIndex(dx, dz)] = neighbour->heights;
+        }
+    }
+
+    setFootprintBusy(entry, stage, true);
+    entry.running = stage;
+    entry.cancel = false;
+    m_inFlight++;
+
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_running++;
+    }
+
+    uint64_t key = toKey(entry.x, entry.z);
+    uint16_t* heights = entry.heights;
+    const std::atomic<bool>* cancel = &entry.cancel;
+
+    m_pool.submit([this, footprint, stage, key, heights, cancel]()
+    {
+        auto start = Clock::now();
+        bool finished = false;
+
+        switch (stage)
+        {
+        case STAGE_NOISE:
+            finished = generateNoise(m_settings, m_heightNoise, m_detailNoise, footprint, heights, *cancel);
+            break;
+        case STAGE_SURFACE:
+            finished = generateSurface(m_settings, footprint, *cancel);
+            break;
+        case STAGE_CARVED:
+            finished = generateCaves(m_settings, footprint, *cancel);
+            break;
+        case STAGE_DECORATED:
+            finished = generateTrees(m_settings, m_forestNoise, footprint, *cancel);
+            break;
+        default:
+            break;
+        }
+
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_finished.push_back({ key, stage, !finished, elapsedMs(start) });
+        m_running--;
+        m_jobDone.notify_all();
+    });
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "block.h"
+#include "chunk.h"
+#include "../memory/pointers.h"
+#include "../utility/threadpool.h"
+#include "../utility/noise.h"
+#include "../utility/vec.h"
+
+class Frustum;
+
+// Generates chunks on the thread pool in stages. A stage that looks at or writes into neighbouring
+// chunks only runs once they've reached the stage before and nothing else is working on them, and
+// a chunk is handed out once no neighbour can write into it any more. Work closest to the camera
+// goes first, chunks in view ahead of those behind, and chunks that leave range are cancelled
+class TerrainGenerator
+{
+public:
+    enum Stage : uint8_t
+    {
+        STAGE_EMPTY,
+
+        // Stone and water from a 3D density field
+        STAGE_NOISE,
+
+        // Grass, dirt and sand on top, bare stone where the slope to a neighbouring column is steep
+        STAGE_SURFACE,
+
+        // Worm caves, started from chunks up to a few chunks away
+        STAGE_CARVED,
+
+        // Trees, which may reach into neighbouring chunks
+        STAGE_DECORATED,
+
+        STAGE_COUNT
+    };
+
+    struct Settings
+    {
+        uint64_t seed = 0;
+
+        // Chunks out from the camera chunk that get finished and handed out
+        int viewDistance = 12;
+
+        int seaLevel = 62;
+        int baseHeight = 68;
+
+        BlockId stone = 1;
+        BlockId dirt = 2;
+        BlockId grass = 3;
+        BlockId sand = 4;
+        BlockId water = 5;
+        BlockId log = 6;
+        BlockId leaves = 7;
+    };
+
+    using ChunkCallback = std::function<void(ScopedPtr<Chunk> chunk)>;
+
+    struct Stats
+    {
+        // Chunks at any stage, including the ring only generated far enough to support its neighbours
+        size_t tracked = 0;
+
+        // Jobs ready to run at the last update, whether or not there was room to start them
+        size_t queueDepth = 0;
+
+        size_t inFlight = 0;
+
+        // Finished chunks poll() hasn't handed out yet
+        size_t waiting = 0;
+
+        size_t generated = 0;
+        size_t cancelled = 0;
+        size_t stageJobs[STAGE_COUNT] = {};
+        double stageMs[STAGE_COUNT] = {};
+
+        // Over the last second or so
+        double chunksPerSecond = 0.0;
+    };
+
+private:
+    struct Entry
+    {
+        int x;
+        int z;
+
+        // Null once handed out
+        ScopedPtr<Chunk> chunk;
+
+        Stage stage = STAGE_EMPTY;
+
+        // Stage the job centred on this chunk is producing, STAGE_EMPTY if there's none
+        Stage running = STAGE_EMPTY;
+
+        // Stage the camera needs this chunk at, one past STAGE_DECORATED to hand it out
+        int required = 0;
+
+        // Part of a running job's footprint
+        bool busy = false;
+        bool delivered = false;
+
+        // Set for the running job centred on this chunk when it's no longer needed
+        std::atomic<bool> cancel { false };
+
+        // Top of the terrain per column as the noise stage left it. Later stages change the blocks
+        // but never this, so neighbours read the same heights whatever stage this chunk is at
+        uint16_t heights[Chunk::SIZE * Chunk::SIZE] = {};
+    };
+
+    struct Finished
+    {
+        uint64_t key;
+        Stage stage;
+        bool cancelled;
+        double ms;
+    };
+
+    Settings m_settings;
+    ThreadPool& m_pool;
+
+    // Seeded from m_settings.seed, read by every worker
+    Noise m_heightNoise;
+    Noise m_detailNoise;
+    Noise m_forestNoise;
+
+    size_t m_maxInFlight;
+
+    // Main thread only
+    std::unordered_map<uint64_t, Entry> m_entries;
+    std::vector<ScopedPtr<Chunk>> m_ready;
+    Vec2<int> m_cameraChunk { 0, 0 };
+    bool m_hasCamera = false;
+    size_t m_inFlight = 0;
+    Stats m_stats;
+
+    std::chrono::steady_clock::time_point m_rateStart;
+    size_t m_rateCount = 0;
+
+    // Shared with the workers
+    std::mutex m_mutex;
+    std::condition_variable m_jobDone;
+    std::vector<Finished> m_finished;
+    size_t m_running = 0;
+
+    static uint64_t toKey(int chunkX, int chunkZ)
+    {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(chunkX)) << 32) | static_cast<uint32_t>(chunkZ);
+    }
+
+    Entry* find(int chunkX, int chunkZ);
+
+    void collectFinished();
+
+    void updateRequirements();
+
+    bool canRun(const Entry& entry, Stage stage);
+
+    bool canDeliver(const Entry& entry);
+
+    void setFootprintBusy(const Entry& entry, Stage stage, bool busy);
+
+    void dispatch(Entry& entry, Stage stage);
+
+public:
+    TerrainGenerator(const Settings& settings, ThreadPool& pool, size_t maxInFlight = 32);
+
+    // Cancels and waits for jobs still running
+    ~TerrainGenerator();
+
+    TerrainGenerator(const TerrainGenerator& other) = delete;
+
+    TerrainGenerator& operator=(const TerrainGenerator& other) = delete;
+
+    // Call once a frame. Picks up finished stages, retargets around the camera and starts new jobs.
+    // frustum may be null, then every direction is treated alike
+    void update(const Vec3<double>& camera, const Frustum* frustum);
+
+    // Hands out finished chunks. A chunk that went out of range and came back is generated and
+    // handed out again, callers that kept it or can load it from disk should drop the new one
+    size_t poll(const ChunkCallback& callback);
+
+    const Settings& getSettings() const { return m_settings; }
+
+    const Stats& getStats() const { return m_stats; }
+
+    // A few lines of stats for the debug window, see Window::addDebugPanel
+    std::string getDebugText() const;
+};
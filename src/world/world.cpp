@@ -0,0 +1,142 @@
+#include "world.h"
+#include <algorithm>
+
+Chunk* World::getChunk(int chunkX, int chunkZ)
+{
+    auto it = m_chunks.find(key(chunkX, chunkZ));
+    return it == m_chunks.end() ? nullptr : it->second.get();
+}
+
+const Chunk* World::getChunk(int chunkX, int chunkZ) const
+{
+    auto it = m_chunks.find(key(chunkX, chunkZ));
+    return it == m_chunks.end() ? nullptr : it->second.get();
+}
+
+Chunk& World::createChunk(int chunkX, int chunkZ)
+{
+    ScopedPtr<Chunk>& chunk = m_chunks[key(chunkX, chunkZ)];
+    if (!chunk)
+    {
+        chunk = MakeScoped<Chunk>(chunkX, chunkZ);
+    }
+    return *chunk;
+}
+
+void World::removeChunk(int chunkX, int chunkZ)
+{
+    m_chunks.erase(key(chunkX, chunkZ));
+}
+
+BlockId World::getBlock(int x, int y, int z) const
+{
+    const Chunk* chunk = getChunk(toChunk(x), toChunk(z));
+    return chunk ? chunk->getBlock(toLocal(x), y, toLocal(z)) : BLOCK_AIR;
+}
+
+BlockId World::setBlock(int x, int y, int z, BlockId block)
+{
+    Chunk* chunk = getChunk(toChunk(x), toChunk(z));
+    if (!chunk || y < 0 || y >= Chunk::HEIGHT)
+    {
+        return BLOCK_AIR;
+    }
+
+    BlockId previous = chunk->setBlock(toLocal(x), y, toLocal(z), block);
+    if (previous != block)
+    {
+        ++m_editCount;
+        markBlocksDirty(x, y, z, x, y, z);
+    }
+    return previous;
+}
+
+size_t World::fill(int minX, int minY, int minZ, int maxX, int maxY, int maxZ, BlockId block)
+{
+    minY = std::max(minY, 0);
+    maxY = std::min(maxY, Chunk::HEIGHT - 1);
+
+    size_t changed = 0;
+
+    // Walk chunk by chunk so each column is looked up once
+    for (int chunkZ = toChunk(minZ); chunkZ <= toChunk(maxZ); ++chunkZ)
+    {
+        for (int chunkX = toChunk(minX); chunkX <= toChunk(maxX); ++chunkX)
+        {
+            Chunk* chunk = getChunk(chunkX, chunkZ);
+            if (!chunk)
+            {
+                continue;
+            }
+
+            int startX = std::max(minX, chunkX * Chunk::SIZE);
+            int endX = std::min(maxX, chunkX * Chunk::SIZE + Chunk::SIZE - 1);
+            int startZ = std::max(minZ, chunkZ * Chunk::SIZE);
+            int endZ = std::min(maxZ, chunkZ * Chunk::SIZE + Chunk::SIZE - 1);
+
+            for (int y = minY; y <= maxY; ++y)
+            {
+                for (int z = startZ; z <= endZ; ++z)
+                {
+                    for (int x = startX; x <= endX; ++x)
+                    {
+                        changed += chunk->setBlock(toLocal(x), y, toLocal(z), block) != block;
+                    }
+                }
+            }
+        }
+    }
+
+    if (changed > 0 && minY <= maxY)
+    {
+        m_editCount += changed;
+        markBlocksDirty(minX, minY, minZ, maxX, maxY, maxZ);
+    }
+    return changed;
+}
+
+void World::markBlocksDirty(int minX, int minY, int minZ, int maxX, int maxY, int maxZ)
+{
+    // One block of padding reaches into a neighbouring section only when the box touches its border
+    int minSectionY = std::max(toChunk(minY - 1), 0);
+    int maxSectionY = std::min(toChunk(maxY + 1), Chunk::SECTION_COUNT - 1);
+
+    for (int z = toChunk(minZ - 1); z <= toChunk(maxZ + 1); ++z)
+    {
+        for (int x = toChunk(minX - 1); x <= toChunk(maxX + 1); ++x)
+        {
+            for (int y = minSectionY; y <= maxSectionY; ++y)
+            {
+                m_dirtySections.insert({ x, y, z });
+            }
+        }
+    }
+}
+
+void World::markChunkDirty(int chunkX, int chunkZ)
+{
+    markBlocksDirty(chunkX * Chunk::SIZE, 0, chunkZ * Chunk::SIZE,
+        chunkX * Chunk::SIZE + Chunk::SIZE - 1, Chunk::HEIGHT - 1, chunkZ * Chunk::SIZE + Chunk::SIZE - 1);
+}
+
+void World::markSectionDirty(const SectionPos& pos)
+{
+    m_dirtySections.insert(pos);
+}
+
+void World::takeDirtySections(std::vector<SectionPos>& sections)
+{
+    sections.insert(sections.end(), m_dirtySections.begin(), m_dirtySections.end());
+    m_dirtySections.clear();
+    m_editCount = 0;
+}
+
+size_t World::getMemoryUsage() const
+{
+    size_t bytes = sizeof(World) + m_chunks.bucket_count() * sizeof(void*);
+    for (const auto& entry : m_chunks)
+    {
+        bytes += sizeof(entry) + entry.second->getMemoryUsage();
+    }
+    return bytes;
+}
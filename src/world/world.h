@@ -0,0 +1,86 @@
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <cstdint>
+#include "block.h"
+#include "chunk.h"
+#include "sectionpos.h"
+#include "../memory/pointers.h"
+
+// Loaded chunks keyed by chunk coordinate. Edits made through the world are tracked as a set
+// of dirty sections, so any number of edits in a tick cost one remesh per touched section
+class World
+{
+private:
+    std::unordered_map<uint64_t, ScopedPtr<Chunk>> m_chunks;
+
+    std::unordered_set<SectionPos> m_dirtySections;
+    size_t m_editCount = 0;
+
+    // Marks every section whose mesh can see the blocks in the box, including neighbours across
+    // faces, edges and corners, which the mesher reads for culling and ambient occlusion
+    void markBlocksDirty(int minX, int minY, int minZ, int maxX, int maxY, int maxZ);
+
+    static uint64_t key(int chunkX, int chunkZ)
+    {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(chunkX)) << 32) | static_cast<uint32_t>(chunkZ);
+    }
+
+public:
+    static int toChunk(int block) { return block >> 4; }
+    static int toLocal(int block) { return block & (Chunk::SIZE - 1); }
+
+    Chunk* getChunk(int chunkX, int chunkZ);
+    const Chunk* getChunk(int chunkX, int chunkZ) const;
+
+    // Returns the existing chunk if it's already loaded
+    Chunk& createChunk(int chunkX, int chunkZ);
+
+    void removeChunk(int chunkX, int chunkZ);
+
+    size_t getChunkCount() const { return m_chunks.size(); }
+
+    // World block coordinates. Blocks in unloaded chunks read as air
+    BlockId getBlock(int x, int y, int z) const;
+
+    // Returns the block that was replaced, writes to unloaded chunks are ignored
+    BlockId setBlock(int x, int y, int z, BlockId block);
+
+    // Sets every block in the inclusive box, for explosions and mass fills. Returns how many changed
+    size_t fill(int minX, int minY, int minZ, int maxX, int maxY, int maxZ, BlockId block);
+
+    // For chunks whose blocks were written directly, like freshly generated or loaded ones
+    void markChunkDirty(int chunkX, int chunkZ);
+
+    void markSectionDirty(const SectionPos& pos);
+
+    // Moves the sections dirtied since the last call into sections, usually once per tick
+    void takeDirtySections(std::vector<SectionPos>& sections);
+
+    size_t getDirtySectionCount() const { return m_dirtySections.size(); }
+
+    // Block changes since the last takeDirtySections
+    size_t getEditCount() const { return m_editCount; }
+
+    template<typename Func>
+    void forEachChunk(Func&& func)
+    {
+        for (auto& entry : m_chunks)
+        {
+            func(*entry.second);
+        }
+    }
+
+    template<typename Func>
+    void forEachChunk(Func&& func) const
+    {
+        for (const auto& entry : m_chunks)
+        {
+            func(static_cast<const Chunk&>(*entry.second));
+        }
+    }
+
+    size_t getMemoryUsage() const;
+};